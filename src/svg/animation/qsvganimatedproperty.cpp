@@ -76,6 +76,12 @@ QVariant QSvgAbstractAnimatedProperty::interpolatedValue() const
     return m_interpolatedValue;
 }
 
+// Counts the changes of the interpolated value
+quint64 QSvgAbstractAnimatedProperty::valueRevision() const
+{
+    return m_valueRevision;
+}
+
 QSvgAbstractAnimatedProperty *QSvgAbstractAnimatedProperty::createAnimatedProperty(const QString &name)
 {
     if (animatableProperties->isEmpty())
@@ -128,7 +134,7 @@ void QSvgAnimatedPropertyColor::interpolate(uint index, qreal t)
     int green  = lerp(c1.green(), c2.green(), t);
     int blue   = lerp(c1.blue(), c2.blue(), t);
 
-    m_interpolatedValue = QColor(red, green, blue, alpha);
+    setInterpolatedValue(QColor(red, green, blue, alpha));
 }
 
 QSvgAnimatedPropertyTransform::QSvgAnimatedPropertyTransform(const QString &name)
@@ -234,7 +240,7 @@ void QSvgAnimatedPropertyTransform::interpolate(uint index, qreal t)
         transform.translate(translation.x(), translation.y());
     }
 
-    m_interpolatedValue = transform;
+    setInterpolatedValue(transform);
 }
 
 QT_END_NAMESPACE
@@ -42,12 +42,26 @@ public:
     QStringView propertyName() const;
     Type type() const;
     QVariant interpolatedValue() const;
+    quint64 valueRevision() const;
     virtual void interpolate(uint index, qreal t) = 0;
 
     static QSvgAbstractAnimatedProperty *createAnimatedProperty(const QString &name);
 protected:
+    // Stores value, counting the revision up only if it differs from the current value
+    template <typename T>
+    void setInterpolatedValue(const T &value)
+    {
+        if (m_interpolatedValue.metaType() == QMetaType::fromType<T>()
+            && *static_cast<const T *>(m_interpolatedValue.constData()) == value) {
+            return;
+        }
+        m_interpolatedValue = QVariant::fromValue(value);
+        ++m_valueRevision;
+    }
+
     QList<qreal> m_keyFrames;
     QVariant m_interpolatedValue;
+    quint64 m_valueRevision = 0;
 
 private:
     QString m_propertyName;
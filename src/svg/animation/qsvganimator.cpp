@@ -3,12 +3,14 @@
 
 #include "qsvganimator_p.h"
 #include <QtCore/qdatetime.h>
+#include <QtCore/qvarlengtharray.h>
 
 QT_BEGIN_NAMESPACE
 
 QSvgAnimator::QSvgAnimator()
     : m_time(0)
     , m_animationDuration(0)
+    , m_frame(0)
 {
 }
 
@@ -30,12 +32,32 @@ QList<QSvgAbstractAnimation *> QSvgAnimator::animationsForNode(const QSvgNode *n
 void QSvgAnimator::advanceAnimations()
 {
     qreal elapsedTime = currentElapsed();
+    ++m_frame;
 
     for (auto itr = m_animations.begin(); itr != m_animations.end(); ++itr) {
         QList<QSvgAbstractAnimation *> &nodeAnimations = itr.value();
         for (QSvgAbstractAnimation *anim : nodeAnimations) {
-            if (!anim->finished())
-                anim->evaluateAnimation(elapsedTime);
+            if (anim->finished())
+                continue;
+
+            const QList<QSvgAbstractAnimatedProperty *> props = anim->properties();
+            QVarLengthArray<quint64, 4> previousRevisions;
+            for (const QSvgAbstractAnimatedProperty *prop : props)
+                previousRevisions.append(prop->valueRevision());
+
+            anim->evaluateAnimation(elapsedTime);
+
+            // Remember in which frame the node last changed, so that renderings
+            // of unchanged subtrees can be reused
+            for (qsizetype i = 0; i < props.size(); ++i) {
+                if (props.at(i)->valueRevision() == previousRevisions.at(i))
+                    continue;
+                NodeChanges &changes = m_changes[itr.key()];
+                if (props.at(i)->type() == QSvgAbstractAnimatedProperty::Transform)
+                    changes.transform = m_frame;
+                else
+                    changes.content = m_frame;
+            }
         }
     }
 
@@ -100,4 +122,48 @@ void QSvgAnimator::applyAnimationsOnNode(const QSvgNode *node, QPainter *p)
     }
 }
 
+// The number of times the animations have been advanced
+quint64 QSvgAnimator::frame() const
+{
+    return m_frame;
+}
+
+// Nodes below these are not drawn in place, but wherever they are referenced
+static bool isReferencedContent(const QSvgNode *node)
+{
+    for (const QSvgNode *n = node->parent(); n; n = n->parent()) {
+        switch (n->type()) {
+        case QSvgNode::Defs:
+        case QSvgNode::Symbol:
+        case QSvgNode::Marker:
+        case QSvgNode::Pattern:
+        case QSvgNode::Mask:
+        case QSvgNode::ClipPath:
+        case QSvgNode::Filter:
+            return true;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+// Returns true if the rendering of node and its children may have changed
+// since frame, apart from the transform of node itself.
+bool QSvgAnimator::subtreeChangedSince(const QSvgNode *node, quint64 frame) const
+{
+    for (auto itr = m_changes.cbegin(); itr != m_changes.cend(); ++itr) {
+        const QSvgNode *changedNode = itr.key();
+        const NodeChanges &changes = itr.value();
+        if (changedNode == node) {
+            if (changes.content > frame)
+                return true;
+        } else if (qMax(changes.content, changes.transform) > frame) {
+            if (changedNode->isDescendantOf(node) || isReferencedContent(changedNode))
+                return true;
+        }
+    }
+    return false;
+}
+
 QT_END_NAMESPACE
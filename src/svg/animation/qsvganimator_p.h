@@ -39,10 +39,20 @@ public:
 
     void applyAnimationsOnNode(const QSvgNode *node, QPainter *p);
 
+    quint64 frame() const;
+    bool subtreeChangedSince(const QSvgNode *node, quint64 frame) const;
+
 private:
+    struct NodeChanges {
+        quint64 content = 0;
+        quint64 transform = 0;
+    };
+
     QHash<const QSvgNode *, QList<QSvgAbstractAnimation *>> m_animations;
+    QHash<const QSvgNode *, NodeChanges> m_changes;
     qint64 m_time;
     qint64 m_animationDuration;
+    quint64 m_frame;
 };
 
 QT_END_NAMESPACE
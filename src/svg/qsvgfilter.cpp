@@ -9,7 +9,12 @@
 #include "qpainter.h"
 
 #include <QLoggingCategory>
+#include <QtCore/qmath.h>
+#include <QtCore/private/qsimd_p.h>
+#include <QtGui/qcolorspace.h>
+#include <QtGui/qcolortransform.h>
 #include <QtGui/qimageiohandler.h>
+#include <QtGui/qrgbafloat.h>
 #include <QVector4D>
 
 QT_BEGIN_NAMESPACE
@@ -74,11 +79,50 @@ void QSvgFeFilterPrimitive::clipToTransformedBounds(QImage *buffer, QPainter *p,
     painter.fillPath(clipPath, Qt::transparent);
 }
 
+QRectF QSvgFeFilterPrimitive::requiredInputRegion(QPainter *, const QRectF &outputRegion,
+                                                  const QRectF &, const QRectF &,
+                                                  QtSvg::UnitTypes, QtSvg::UnitTypes) const
+{
+    // Most primitives operate per pixel, so they need exactly the area they produce.
+    return outputRegion;
+}
+
+QStringList QSvgFeFilterPrimitive::inputs() const
+{
+    return QStringList{m_input};
+}
+
 bool QSvgFeFilterPrimitive::requiresSourceAlpha() const
 {
     return m_input == QLatin1StringView("SourceAlpha");
 }
 
+const QSvgFilterContainer *QSvgFeFilterPrimitive::filterContainer() const
+{
+    for (const QSvgNode *node = parent(); node; node = node->parent()) {
+        if (node->type() == QSvgNode::Filter)
+            return static_cast<const QSvgFilterContainer *>(node);
+    }
+    return nullptr;
+}
+
+QImage::Format QSvgFeFilterPrimitive::bufferFormat() const
+{
+    const QSvgFilterContainer *filter = filterContainer();
+    return filter ? filter->bufferFormat() : QImage::Format_ARGB32_Premultiplied;
+}
+
+bool QSvgFeFilterPrimitive::usesLinearLight() const
+{
+    const QSvgFilterContainer *filter = filterContainer();
+    return filter && filter->usesLinearLight();
+}
+
+static inline bool isHighPrecision(const QImage &image)
+{
+    return image.format() == QImage::Format_RGBA32FPx4_Premultiplied;
+}
+
 const QSvgFeFilterPrimitive *QSvgFeFilterPrimitive::castToFilterPrimitive(const QSvgNode *node)
 {
     if (node->type() == QSvgNode::FeMerge ||
@@ -87,7 +131,11 @@ const QSvgFeFilterPrimitive *QSvgFeFilterPrimitive::castToFilterPrimitive(const
         node->type() == QSvgNode::FeOffset ||
         node->type() == QSvgNode::FeComposite ||
         node->type() == QSvgNode::FeFlood ||
-        node->type() == QSvgNode::FeBlend ) {
+        node->type() == QSvgNode::FeBlend ||
+        node->type() == QSvgNode::FeTurbulence ||
+        node->type() == QSvgNode::FeConvolvematrix ||
+        node->type() == QSvgNode::FeMorphology ||
+        node->type() == QSvgNode::FeDisplacementmap) {
         return reinterpret_cast<const QSvgFeFilterPrimitive*>(node);
     } else {
         return nullptr;
@@ -197,25 +245,62 @@ QSvgNode::Type QSvgFeColorMatrix::type() const
 
 QImage QSvgFeColorMatrix::apply(const QMap<QString, QImage> &sources, QPainter *p,
                                 const QRectF &itemBounds, const QRectF &filterBounds,
-                                QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+                                QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                                const QRectF &regionOfInterest) const
 {
     if (!sources.contains(m_input))
         return QImage();
     QImage source = sources[m_input];
 
-    QRect clipRectGlob = globalSubRegion(p, itemBounds, filterBounds, primitiveUnits, filterUnits).toRect();
+    QRect clipRectGlob = globalSubRegion(p, itemBounds, filterBounds, primitiveUnits, filterUnits)
+                                 .intersected(regionOfInterest).toRect();
     if (clipRectGlob.isEmpty())
         return QImage();
 
     QImage result;
-    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), QImage::Format_ARGB32_Premultiplied, &result)) {
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
         qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
         return QImage();
     }
     result.setOffset(clipRectGlob.topLeft());
     result.fill(Qt::transparent);
 
-    Q_ASSERT(source.depth() == 32);
+    Q_ASSERT(source.format() == bufferFormat());
+
+    if (isHighPrecision(result)) {
+        const qreal *m = m_matrix.constData();
+        for (int i = 0; i < result.height(); i++) {
+            int sourceI = i - source.offset().y() + result.offset().y();
+
+            if (sourceI < 0 || sourceI >= source.height())
+                continue;
+
+            const QRgbaFloat32 *sourceLine = reinterpret_cast<const QRgbaFloat32 *>(source.constScanLine(sourceI));
+            QRgbaFloat32 *resultLine = reinterpret_cast<QRgbaFloat32 *>(result.scanLine(i));
+
+            for (int j = 0; j < result.width(); j++) {
+                int sourceJ = j - source.offset().x() + result.offset().x();
+
+                if (sourceJ < 0 || sourceJ >= source.width())
+                    continue;
+
+                const QRgbaFloat32 sourceColor = sourceLine[sourceJ].unpremultiplied();
+                float rgba[4];
+                for (int row = 0; row < 4; row++) {
+                    const qreal v = m[0 + row * 5] * sourceColor.r +
+                                    m[1 + row * 5] * sourceColor.g +
+                                    m[2 + row * 5] * sourceColor.b +
+                                    m[3 + row * 5] * sourceColor.a +
+                                    m[4 + row * 5];
+                    rgba[row] = qBound(0., v, 1.);
+                }
+                resultLine[j] = QRgbaFloat32{rgba[0], rgba[1], rgba[2], rgba[3]}.premultiplied();
+            }
+        }
+
+        clipToTransformedBounds(&result, p, localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits));
+        return result;
+    }
 
     for (int i = 0; i < result.height(); i++) {
         int sourceI = i - source.offset().y() + result.offset().y();
@@ -287,57 +372,85 @@ QSvgNode::Type QSvgFeGaussianBlur::type() const
     return QSvgNode::FeGaussianblur;
 }
 
-QImage QSvgFeGaussianBlur::apply(const QMap<QString, QImage> &sources, QPainter *p,
-                                 const QRectF &itemBounds, const QRectF &filterBounds,
-                                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+static QTransform blurScaleTransform(const QTransform &xf)
 {
-    if (!sources.contains(m_input))
-        return QImage();
-    QImage source = sources[m_input];
-    Q_ASSERT(source.depth() == 32);
-
-    if (m_stdDeviationX == 0 && m_stdDeviationY == 0)
-        return source;
-
-    const qreal scaleX = qHypot(p->transform().m11(), p->transform().m21());
-    const qreal scaleY = qHypot(p->transform().m12(), p->transform().m22());
+    return QTransform::fromScale(qHypot(xf.m11(), xf.m21()), qHypot(xf.m12(), xf.m22()));
+}
 
-    qreal sigma_x = scaleX * m_stdDeviationX;
-    qreal sigma_y = scaleY * m_stdDeviationY;
-    if (primitiveUnits == QtSvg::UnitTypes::objectBoundingBox) {
-        sigma_x *= itemBounds.width();
-        sigma_y *= itemBounds.height();
-    }
+// https://www.w3.org/TR/SVG11/filters.html#feGaussianBlurElement:
+// if d is odd, use three box-blurs of size 'd', centered on the output pixel.
+// if d is even, two box-blurs of size 'd' (the first one centered on the pixel boundary
+// between the output pixel and the one to the left, the second one centered on the pixel
+// boundary between the output pixel and the one to the right) and one box blur of size
+// 'd+1' centered on the output pixel.
+static std::pair<int, int> boxBlurExtents(int d, int iteration)
+{
+    d = qMax(1, d);     // Treat d == 0 just like d == 1
+    std::pair<int, int> result;
+    if (d % 2 == 1)
+        result = {d / 2 + 1, d / 2};
+    else if (iteration == 0)
+        result = {d / 2 + 1, d / 2 - 1};
+    else if (iteration == 1)
+        result = {d / 2, d / 2};
+    else
+        result = {d / 2 + 1, d / 2};
+    Q_ASSERT(result.first + result.second > 0);
+    return result;
+}
 
-    constexpr double sd = 3. * M_SQRT1_2 / M_2_SQRTPI; // 3 * sqrt(2 * pi) / 4
-    const int dx = floor(sigma_x * sd + 0.5);
-    const int dy = floor(sigma_y * sd + 0.5);
+// Same as boxBlur() for floating point buffers, processing all channels at once
+static void boxBlurHighPrecision(QImage *image, int dx, int dy)
+{
+    const int sourceHeight = image->height();
+    const int sourceWidth = image->width();
+    const qsizetype stride = qsizetype(sourceWidth) * 4;
+    QVarLengthArray<double, 32 * 32> buffer(stride * sourceHeight);
 
-    const QTransform scaleXr = QTransform::fromScale(scaleX, scaleY);
-    const QTransform restXr = scaleXr.inverted() * p->transform();
+    for (int m = 0; m < 3; m++) {
+        for (int j = 0; j < sourceHeight; j++) {
+            const float *line = reinterpret_cast<const float *>(image->constScanLine(j));
+            double *sums = buffer.data() + j * stride;
+            const double *sumsAbove = j > 0 ? sums - stride : nullptr;
+            double rowSums[4] = { 0, 0, 0, 0 };
+            for (int i = 0; i < sourceWidth; i++) {
+                for (int c = 0; c < 4; c++) {
+                    rowSums[c] += line[i * 4 + c];
+                    sums[i * 4 + c] = rowSums[c] + (sumsAbove ? sumsAbove[i * 4 + c] : 0.);
+                }
+            }
+        }
 
-    QRect clipRectGlob = scaleXr.mapRect(localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits)).toRect();
-    if (clipRectGlob.isEmpty())
-        return QImage();
+        const auto [dxleft, dxright] = boxBlurExtents(dx, m);
+        const auto [dytop, dybottom] = boxBlurExtents(dy, m);
+        const double area = double(dxleft + dxright) * (dytop + dybottom);
+        for (int j = 0; j < sourceHeight; j++) {
+            const double *top = buffer.constData() + qMax(0, j - dytop) * stride;
+            const double *bottom = buffer.constData() + qMin(sourceHeight - 1, j + dybottom) * stride;
+            float *line = reinterpret_cast<float *>(image->scanLine(j));
+            for (int i = 0; i < sourceWidth; i++) {
+                const int i1 = qMax(0, i - dxleft) * 4;
+                const int i2 = qMin(sourceWidth - 1, i + dxright) * 4;
+                for (int c = 0; c < 4; c++)
+                    line[i * 4 + c] = (bottom[i2 + c] - bottom[i1 + c] - top[i2 + c] + top[i1 + c]) / area;
+            }
+        }
+    }
+}
 
-    QImage tempSource;
-    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), QImage::Format_ARGB32_Premultiplied, &tempSource)) {
-        qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
-        return QImage();
+// Runs the three box-blur passes approximating a Gaussian blur with box sizes dx and dy
+static void boxBlur(QImage *image, int dx, int dy)
+{
+    if (isHighPrecision(*image)) {
+        boxBlurHighPrecision(image, dx, dy);
+        return;
     }
-    tempSource.setOffset(clipRectGlob.topLeft());
-    tempSource.fill(Qt::transparent);
-    QPainter copyPainter(&tempSource);
-    copyPainter.translate(-tempSource.offset());
-    copyPainter.setTransform(restXr.inverted(), true);
-    copyPainter.drawImage(source.offset(), source);
-    copyPainter.end();
 
-    QVarLengthArray<uint64_t, 32 * 32> buffer(tempSource.width() * tempSource.height());
+    QVarLengthArray<uint64_t, 32 * 32> buffer(image->width() * image->height());
 
-    const int sourceHeight = tempSource.height();
-    const int sourceWidth = tempSource.width();
-    QRgb *rawImage = reinterpret_cast<QRgb *>(tempSource.bits());
+    const int sourceHeight = image->height();
+    const int sourceWidth = image->width();
+    QRgb *rawImage = reinterpret_cast<QRgb *>(image->bits());
 
     // https://www.w3.org/TR/SVG11/filters.html#feGaussianBlurElement:
     // Three successive box-blurs build a piece-wise quadratic convolution kernel,
@@ -358,29 +471,8 @@ QImage QSvgFeGaussianBlur::apply(const QMap<QString, QImage> &sources, QPainter
                 }
             }
 
-            // https://www.w3.org/TR/SVG11/filters.html#feGaussianBlurElement:
-            // if d is odd, use three box-blurs of size 'd', centered on the output pixel.
-            // if d is even, two box-blurs of size 'd' (the first one centered on the pixel boundary
-            // between the output pixel and the one to the left, the second one centered on the pixel
-            // boundary between the output pixel and the one to the right) and one box blur of size
-            // 'd+1' centered on the output pixel.
-            auto adjustD = [](int d, int iteration) {
-                d = qMax(1, d);     // Treat d == 0 just like d == 1
-                std::pair<int, int> result;
-                if (d % 2 == 1)
-                    result = {d / 2 + 1, d / 2};
-                else if (iteration == 0)
-                    result = {d / 2 + 1, d / 2 - 1};
-                else if (iteration == 1)
-                    result = {d / 2, d / 2};
-                else
-                    result = {d / 2 + 1, d / 2};
-                Q_ASSERT(result.first + result.second > 0);
-                return result;
-            };
-
-            const auto [dxleft, dxright] = adjustD(dx, m);
-            const auto [dytop, dybottom] = adjustD(dy, m);
+            const auto [dxleft, dxright] = boxBlurExtents(dx, m);
+            const auto [dytop, dybottom] = boxBlurExtents(dy, m);
             for (int i = 0; i < sourceWidth; i++) {
                 for (int j = 0; j < sourceHeight; j++) {
                     const int i1 = qMax(0, i - dxleft);
@@ -402,11 +494,158 @@ QImage QSvgFeGaussianBlur::apply(const QMap<QString, QImage> &sources, QPainter
             }
         }
     }
+}
+
+// Returns the power-of-two factors by which a blur with box sizes d can be downsampled,
+// while still leaving a box of several pixels at the reduced resolution. Downsampling
+// is only used when image-rendering="optimizeSpeed" disables smooth pixmap transforms.
+static QSize blurDownscaleFactor(QPainter *p, const QSize &d)
+{
+    if (p->testRenderHint(QPainter::SmoothPixmapTransform))
+        return QSize(1, 1);
+
+    constexpr int minimumBoxSize = 8;
+    constexpr int maximumFactor = 16;
+
+    auto factor = [](int boxSize) {
+        int f = 1;
+        while (f < maximumFactor && boxSize / (2 * f) >= minimumBoxSize)
+            f *= 2;
+        return f;
+    };
+    return QSize(factor(d.width()), factor(d.height()));
+}
 
-    QRectF trueClipRectGlob = globalSubRegion(p, itemBounds, filterBounds, primitiveUnits, filterUnits);
+QSize QSvgFeGaussianBlur::boxSize(QPainter *p, const QRectF &itemBounds,
+                                  QtSvg::UnitTypes primitiveUnits) const
+{
+    const QTransform scaleXr = blurScaleTransform(p->transform());
+
+    qreal sigma_x = scaleXr.m11() * m_stdDeviationX;
+    qreal sigma_y = scaleXr.m22() * m_stdDeviationY;
+    if (primitiveUnits == QtSvg::UnitTypes::objectBoundingBox) {
+        sigma_x *= itemBounds.width();
+        sigma_y *= itemBounds.height();
+    }
+
+    constexpr double sd = 3. * M_SQRT1_2 / M_2_SQRTPI; // 3 * sqrt(2 * pi) / 4
+    return QSize(floor(sigma_x * sd + 0.5), floor(sigma_y * sd + 0.5));
+}
+
+QRectF QSvgFeGaussianBlur::scaledInputRegion(QPainter *p, const QRectF &outputRegion,
+                                             const QRectF &itemBounds, const QRectF &filterBounds,
+                                             QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+{
+    const QTransform scaleXr = blurScaleTransform(p->transform());
+    const QTransform restXr = scaleXr.inverted() * p->transform();
+    const QSize d = boxSize(p, itemBounds, primitiveUnits);
+
+    // Each of the three box-blur passes reaches at most d / 2 + 1 pixels into its
+    // neighbourhood, and resampling may touch one more (downsampled) pixel.
+    const QSize downscale = blurDownscaleFactor(p, d);
+    const int marginX = 3 * (qMax(1, d.width()) / 2 + 1) + downscale.width();
+    const int marginY = 3 * (qMax(1, d.height()) / 2 + 1) + downscale.height();
+
+    const QRectF subRegion = scaleXr.mapRect(localSubRegion(itemBounds, filterBounds,
+                                                            primitiveUnits, filterUnits));
+    const QRectF outputRect = restXr.inverted().mapRect(outputRegion);
+    return subRegion.intersected(outputRect.adjusted(-marginX, -marginY, marginX, marginY));
+}
+
+QRectF QSvgFeGaussianBlur::requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                                               const QRectF &itemBounds, const QRectF &filterBounds,
+                                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+{
+    if (m_stdDeviationX == 0 && m_stdDeviationY == 0)
+        return outputRegion;
+
+    const QTransform scaleXr = blurScaleTransform(p->transform());
+    const QTransform restXr = scaleXr.inverted() * p->transform();
+    return restXr.mapRect(scaledInputRegion(p, outputRegion, itemBounds, filterBounds,
+                                            primitiveUnits, filterUnits));
+}
+
+QImage QSvgFeGaussianBlur::apply(const QMap<QString, QImage> &sources, QPainter *p,
+                                 const QRectF &itemBounds, const QRectF &filterBounds,
+                                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                                 const QRectF &regionOfInterest) const
+{
+    if (!sources.contains(m_input))
+        return QImage();
+    QImage source = sources[m_input];
+    Q_ASSERT(source.format() == bufferFormat());
+
+    if (m_stdDeviationX == 0 && m_stdDeviationY == 0)
+        return source;
+
+    const QSize d = boxSize(p, itemBounds, primitiveUnits);
+    const int dx = d.width();
+    const int dy = d.height();
+
+    const QTransform scaleXr = blurScaleTransform(p->transform());
+    const QTransform restXr = scaleXr.inverted() * p->transform();
+
+    // Only blur the part of the subregion that contributes to the region of interest
+    QRect clipRectGlob = scaledInputRegion(p, regionOfInterest, itemBounds, filterBounds,
+                                           primitiveUnits, filterUnits).toRect();
+    if (clipRectGlob.isEmpty())
+        return QImage();
+
+    // For large deviations under image-rendering="optimizeSpeed", blur a downsampled copy
+    // and scale the result back up. This is visually equivalent for soft blurs and
+    // reduces the work by the square of the downsampling factor.
+    const QSize downscale = blurDownscaleFactor(p, d);
+    const QSize paddedSize((clipRectGlob.width() + downscale.width() - 1) / downscale.width() * downscale.width(),
+                           (clipRectGlob.height() + downscale.height() - 1) / downscale.height() * downscale.height());
+
+    QImage tempSource;
+    if (!QImageIOHandler::allocateImage(paddedSize, bufferFormat(), &tempSource)) {
+        qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
+        return QImage();
+    }
+    tempSource.setOffset(clipRectGlob.topLeft());
+    tempSource.fill(Qt::transparent);
+    QPainter copyPainter(&tempSource);
+    copyPainter.setClipRect(QRect(QPoint(0, 0), clipRectGlob.size()));
+    copyPainter.translate(-tempSource.offset());
+    copyPainter.setTransform(restXr.inverted(), true);
+    copyPainter.drawImage(source.offset(), source);
+    copyPainter.end();
+
+    if (downscale == QSize(1, 1)) {
+        boxBlur(&tempSource, dx, dy);
+    } else {
+        QImage downscaled = tempSource;
+        for (int fx = 1, fy = 1; fx < downscale.width() || fy < downscale.height();) {
+            const int stepX = fx < downscale.width() ? 2 : 1;
+            const int stepY = fy < downscale.height() ? 2 : 1;
+            downscaled = downscaled.scaled(downscaled.width() / stepX, downscaled.height() / stepY,
+                                           Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            fx *= stepX;
+            fy *= stepY;
+        }
+        if (downscaled.isNull()) {
+            qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
+            return QImage();
+        }
+
+        boxBlur(&downscaled, qRound(qreal(dx) / downscale.width()), qRound(qreal(dy) / downscale.height()));
+
+        tempSource = downscaled.scaled(paddedSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        if (tempSource.isNull()) {
+            qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
+            return QImage();
+        }
+        tempSource.setOffset(clipRectGlob.topLeft());
+    }
+
+    QRectF trueClipRectGlob = globalSubRegion(p, itemBounds, filterBounds, primitiveUnits, filterUnits)
+                                      .intersected(regionOfInterest);
+    if (trueClipRectGlob.toRect().isEmpty())
+        return QImage();
 
     QImage result;
-    if (!QImageIOHandler::allocateImage(trueClipRectGlob.toRect().size(), QImage::Format_ARGB32_Premultiplied, &result)) {
+    if (!QImageIOHandler::allocateImage(trueClipRectGlob.toRect().size(), bufferFormat(), &result)) {
         qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
         return QImage();
     }
@@ -438,9 +677,28 @@ QSvgNode::Type QSvgFeOffset::type() const
     return QSvgNode::FeOffset;
 }
 
+QPoint QSvgFeOffset::globalOffset(QPainter *p, const QRectF &itemBounds,
+                                  QtSvg::UnitTypes primitiveUnits) const
+{
+    QPoint offset(m_dx, m_dy);
+    if (primitiveUnits == QtSvg::UnitTypes::objectBoundingBox) {
+        offset = QPoint(m_dx * itemBounds.width(),
+                        m_dy * itemBounds.height());
+    }
+    return p->transform().map(offset) - p->transform().map(QPoint(0, 0));
+}
+
+QRectF QSvgFeOffset::requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                                         const QRectF &itemBounds, const QRectF &,
+                                         QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes) const
+{
+    return outputRegion.translated(-globalOffset(p, itemBounds, primitiveUnits));
+}
+
 QImage QSvgFeOffset::apply(const QMap<QString, QImage> &sources, QPainter *p,
                            const QRectF &itemBounds, const QRectF &filterBounds,
-                           QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+                           QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                           const QRectF &regionOfInterest) const
 {
     if (!sources.contains(m_input))
         return QImage();
@@ -448,20 +706,15 @@ QImage QSvgFeOffset::apply(const QMap<QString, QImage> &sources, QPainter *p,
     const QImage &source = sources[m_input];
 
     QRectF clipRect = localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits);
-    QRect clipRectGlob = p->transform().mapRect(clipRect).toRect();
+    QRect clipRectGlob = p->transform().mapRect(clipRect).intersected(regionOfInterest).toRect();
 
-    QPoint offset(m_dx, m_dy);
-    if (primitiveUnits == QtSvg::UnitTypes::objectBoundingBox) {
-        offset = QPoint(m_dx * itemBounds.width(),
-                        m_dy * itemBounds.height());
-    }
-    offset = p->transform().map(offset) - p->transform().map(QPoint(0, 0));
+    const QPoint offset = globalOffset(p, itemBounds, primitiveUnits);
 
     if (clipRectGlob.isEmpty())
         return QImage();
 
     QImage result;
-    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), QImage::Format_ARGB32_Premultiplied, &result)) {
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
         qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
         return QImage();
     }
@@ -492,24 +745,26 @@ QSvgNode::Type QSvgFeMerge::type() const
 
 QImage QSvgFeMerge::apply(const QMap<QString, QImage> &sources, QPainter *p,
                           const QRectF &itemBounds, const QRectF &filterBounds,
-                          QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+                          QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                          const QRectF &regionOfInterest) const
 {
     QList<QImage> mergeNodeResults;
     for (int i = 0; i < renderers().size(); i++) {
         QSvgNode *child = renderers().at(i);
         if (child->type() == QSvgNode::FeMergenode) {
             QSvgFeMergeNode *filter = static_cast<QSvgFeMergeNode*>(child);
-            mergeNodeResults.append(filter->apply(sources, p, itemBounds, filterBounds, primitiveUnits, filterUnits));
+            mergeNodeResults.append(filter->apply(sources, p, itemBounds, filterBounds, primitiveUnits, filterUnits,
+                                                  regionOfInterest));
         }
     }
 
     QRectF clipRect = localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits);
-    QRect clipRectGlob = p->transform().mapRect(clipRect).toRect();
+    QRect clipRectGlob = p->transform().mapRect(clipRect).intersected(regionOfInterest).toRect();
     if (clipRectGlob.isEmpty())
         return QImage();
 
     QImage result;
-    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), QImage::Format_ARGB32_Premultiplied, &result)) {
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
         qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
         return QImage();
     }
@@ -526,6 +781,17 @@ QImage QSvgFeMerge::apply(const QMap<QString, QImage> &sources, QPainter *p,
     return result;
 }
 
+QStringList QSvgFeMerge::inputs() const
+{
+    QStringList mergeInputs;
+    for (int i = 0; i < renderers().size(); i++) {
+        QSvgNode *child = renderers().at(i);
+        if (child->type() == QSvgNode::FeMergenode)
+            mergeInputs.append(static_cast<QSvgFeMergeNode *>(child)->inputs());
+    }
+    return mergeInputs;
+}
+
 bool QSvgFeMerge::requiresSourceAlpha() const
 {
     for (int i = 0; i < renderers().size(); i++) {
@@ -552,7 +818,8 @@ QSvgNode::Type QSvgFeMergeNode::type() const
 }
 
 QImage QSvgFeMergeNode::apply(const QMap<QString, QImage> &sources, QPainter *,
-                              const QRectF &, const QRectF &, QtSvg::UnitTypes, QtSvg::UnitTypes) const
+                              const QRectF &, const QRectF &, QtSvg::UnitTypes, QtSvg::UnitTypes,
+                              const QRectF &) const
 {
     return sources.value(m_input);
 }
@@ -575,7 +842,8 @@ QSvgNode::Type QSvgFeComposite::type() const
 
 QImage QSvgFeComposite::apply(const QMap<QString, QImage> &sources, QPainter *p,
                               const QRectF &itemBounds, const QRectF &filterBounds,
-                              QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+                              QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                              const QRectF &regionOfInterest) const
 {
     if (!sources.contains(m_input))
         return QImage();
@@ -583,24 +851,61 @@ QImage QSvgFeComposite::apply(const QMap<QString, QImage> &sources, QPainter *p,
         return QImage();
     QImage source1 = sources[m_input];
     QImage source2 = sources[m_input2];
-    Q_ASSERT(source1.depth() == 32);
-    Q_ASSERT(source2.depth() == 32);
+    Q_ASSERT(source1.format() == bufferFormat());
+    Q_ASSERT(source2.format() == bufferFormat());
 
     QRectF clipRect = localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits);
-    QRect clipRectGlob = p->transform().mapRect(clipRect).toRect();
+    QRect clipRectGlob = p->transform().mapRect(clipRect).intersected(regionOfInterest).toRect();
 
     if (clipRectGlob.isEmpty())
         return QImage();
 
     QImage result;
-    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), QImage::Format_ARGB32_Premultiplied, &result)) {
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
         qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
         return QImage();
     }
     result.setOffset(clipRectGlob.topLeft());
     result.fill(Qt::transparent);
 
-    if (m_operator == Operator::Arithmetic) {
+    if (m_operator == Operator::Arithmetic && isHighPrecision(result)) {
+        const float k1 = m_k.x();
+        const float k2 = m_k.y();
+        const float k3 = m_k.z();
+        const float k4 = m_k.w();
+
+        for (int j = 0; j < result.height(); j++) {
+            int jj1 = j - source1.offset().y() + result.offset().y();
+            int jj2 = j - source2.offset().y() + result.offset().y();
+
+            QRgbaFloat32 *resultLine = reinterpret_cast<QRgbaFloat32 *>(result.scanLine(j));
+            const QRgbaFloat32 *source1Line = nullptr;
+            const QRgbaFloat32 *source2Line = nullptr;
+
+            if (jj1 >= 0 && jj1 < source1.size().height())
+                source1Line = reinterpret_cast<const QRgbaFloat32 *>(source1.constScanLine(jj1));
+            if (jj2 >= 0 && jj2 < source2.size().height())
+                source2Line = reinterpret_cast<const QRgbaFloat32 *>(source2.constScanLine(jj2));
+
+            for (int i = 0; i < result.width(); i++) {
+                int ii1 = i - source1.offset().x() + result.offset().x();
+                int ii2 = i - source2.offset().x() + result.offset().x();
+
+                QRgbaFloat32 s1{0, 0, 0, 0};
+                QRgbaFloat32 s2{0, 0, 0, 0};
+                if (ii1 >= 0 && ii1 < source1.size().width() && source1Line)
+                    s1 = source1Line[ii1];
+                if (ii2 >= 0 && ii2 < source2.size().width() && source2Line)
+                    s2 = source2Line[ii2];
+
+                const float a = qBound(0.f, k1 * s1.a * s2.a + k2 * s1.a + k3 * s2.a + k4, 1.f);
+                resultLine[i] = QRgbaFloat32{qBound(0.f, k1 * s1.r * s2.r + k2 * s1.r + k3 * s2.r + k4, a),
+                                             qBound(0.f, k1 * s1.g * s2.g + k2 * s1.g + k3 * s2.g + k4, a),
+                                             qBound(0.f, k1 * s1.b * s2.b + k2 * s1.b + k3 * s2.b + k4, a),
+                                             a};
+            }
+        }
+    } else if (m_operator == Operator::Arithmetic) {
         const qreal k1 = m_k.x();
         const qreal k2 = m_k.y();
         const qreal k3 = m_k.z();
@@ -689,6 +994,11 @@ QImage QSvgFeComposite::apply(const QMap<QString, QImage> &sources, QPainter *p,
     return result;
 }
 
+QStringList QSvgFeComposite::inputs() const
+{
+    return QStringList{m_input, m_input2};
+}
+
 bool QSvgFeComposite::requiresSourceAlpha() const
 {
     if (QSvgFeFilterPrimitive::requiresSourceAlpha())
@@ -710,21 +1020,39 @@ QSvgNode::Type QSvgFeFlood::type() const
     return QSvgNode::FeFlood;
 }
 
+QRectF QSvgFeFlood::requiredInputRegion(QPainter *, const QRectF &,
+                                        const QRectF &, const QRectF &,
+                                        QtSvg::UnitTypes, QtSvg::UnitTypes) const
+{
+    // feFlood does not read any input
+    return QRectF();
+}
+
 QImage QSvgFeFlood::apply(const QMap<QString, QImage> &,
                           QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                          QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+                          QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                          const QRectF &regionOfInterest) const
 {
 
     QRectF clipRect = localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits);
-    QRect clipRectGlob = p->transform().mapRect(clipRect).toRect();
+    QRect clipRectGlob = p->transform().mapRect(clipRect).intersected(regionOfInterest).toRect();
+    if (clipRectGlob.isEmpty())
+        return QImage();
 
     QImage result;
-    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), QImage::Format_ARGB32_Premultiplied, &result)) {
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
         qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
         return QImage();
     }
     result.setOffset(clipRectGlob.topLeft());
-    result.fill(m_color);
+    if (usesLinearLight()) {
+        // flood-color is given in sRGB, while the filter chain works in linear light
+        static const QColorTransform toLinear = QColorSpace(QColorSpace::SRgb)
+                .transformationToColorSpace(QColorSpace::SRgbLinear);
+        result.fill(toLinear.map(m_color));
+    } else {
+        result.fill(m_color);
+    }
 
     clipToTransformedBounds(&result, p, clipRect);
     return result;
@@ -746,7 +1074,8 @@ QSvgNode::Type QSvgFeBlend::type() const
 
 QImage QSvgFeBlend::apply(const QMap<QString, QImage> &sources, QPainter *p,
                           const QRectF &itemBounds, const QRectF &filterBounds,
-                          QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+                          QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                          const QRectF &regionOfInterest) const
 {
     if (!sources.contains(m_input))
         return QImage();
@@ -754,20 +1083,75 @@ QImage QSvgFeBlend::apply(const QMap<QString, QImage> &sources, QPainter *p,
         return QImage();
     QImage source1 = sources[m_input];
     QImage source2 = sources[m_input2];
-    Q_ASSERT(source1.depth() == 32);
-    Q_ASSERT(source2.depth() == 32);
+    Q_ASSERT(source1.format() == bufferFormat());
+    Q_ASSERT(source2.format() == bufferFormat());
 
     QRectF clipRect = localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits);
-    QRect clipRectGlob = p->transform().mapRect(clipRect).toRect();
+    QRect clipRectGlob = p->transform().mapRect(clipRect).intersected(regionOfInterest).toRect();
+    if (clipRectGlob.isEmpty())
+        return QImage();
 
     QImage result;
-    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), QImage::Format_ARGB32_Premultiplied, &result)) {
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
         qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
         return QImage();
     }
     result.setOffset(clipRectGlob.topLeft());
     result.fill(Qt::transparent);
 
+    if (isHighPrecision(result)) {
+        for (int j = 0; j < result.height(); j++) {
+            int jj1 = j - source1.offset().y() + result.offset().y();
+            int jj2 = j - source2.offset().y() + result.offset().y();
+
+            QRgbaFloat32 *resultLine = reinterpret_cast<QRgbaFloat32 *>(result.scanLine(j));
+            const QRgbaFloat32 *source1Line = nullptr;
+            const QRgbaFloat32 *source2Line = nullptr;
+
+            if (jj1 >= 0 && jj1 < source1.size().height())
+                source1Line = reinterpret_cast<const QRgbaFloat32 *>(source1.constScanLine(jj1));
+            if (jj2 >= 0 && jj2 < source2.size().height())
+                source2Line = reinterpret_cast<const QRgbaFloat32 *>(source2.constScanLine(jj2));
+
+            for (int i = 0; i < result.width(); i++) {
+                int ii1 = i - source1.offset().x() + result.offset().x();
+                int ii2 = i - source2.offset().x() + result.offset().x();
+
+                const QRgbaFloat32 pixel1 = (ii1 >= 0 && ii1 < source1.size().width() && source1Line) ?
+                        source1Line[ii1] : QRgbaFloat32{0, 0, 0, 0};
+                const QRgbaFloat32 pixel2 = (ii2 >= 0 && ii2 < source2.size().width() && source2Line) ?
+                        source2Line[ii2] : QRgbaFloat32{0, 0, 0, 0};
+
+                const float alpha1 = pixel1.a;
+                const float alpha2 = pixel2.a;
+                const float a = qBound(0.f, 1 - (1 - alpha1) * (1 - alpha2), 1.f);
+
+                auto blend = [&](float c1, float c2) {
+                    switch (m_mode) {
+                    case Mode::Normal:
+                        return (1 - alpha1) * c2 + c1;
+                    case Mode::Multiply:
+                        return (1 - alpha1) * c2 + (1 - alpha2) * c1 + c1 * c2;
+                    case Mode::Screen:
+                        return c2 + c1 - c1 * c2;
+                    case Mode::Darken:
+                        return qMin((1 - alpha1) * c2 + c1, (1 - alpha2) * c1 + c2);
+                    case Mode::Lighten:
+                        return qMax((1 - alpha1) * c2 + c1, (1 - alpha2) * c1 + c2);
+                    }
+                    return 0.f;
+                };
+
+                resultLine[i] = QRgbaFloat32{qBound(0.f, blend(pixel1.r, pixel2.r), a),
+                                             qBound(0.f, blend(pixel1.g, pixel2.g), a),
+                                             qBound(0.f, blend(pixel1.b, pixel2.b), a),
+                                             a};
+            }
+        }
+        clipToTransformedBounds(&result, p, clipRect);
+        return result;
+    }
+
     for (int j = 0; j < result.height(); j++) {
         int jj1 = j - source1.offset().y() + result.offset().y();
         int jj2 = j - source2.offset().y() + result.offset().y();
@@ -839,6 +1223,11 @@ QImage QSvgFeBlend::apply(const QMap<QString, QImage> &sources, QPainter *p,
     return result;
 }
 
+QStringList QSvgFeBlend::inputs() const
+{
+    return QStringList{m_input, m_input2};
+}
+
 bool QSvgFeBlend::requiresSourceAlpha() const
 {
     if (QSvgFeFilterPrimitive::requiresSourceAlpha())
@@ -846,6 +1235,861 @@ bool QSvgFeBlend::requiresSourceAlpha() const
     return m_input2 == QLatin1StringView("SourceAlpha");
 }
 
+// The feTurbulence implementation follows the reference code of the SVG 1.1
+// specification, see https://www.w3.org/TR/SVG11/filters.html#feTurbulenceElement
+
+struct QSvgFeTurbulence::StitchInfo
+{
+    qint64 width;  // How much to subtract to wrap for stitching
+    qint64 height;
+    qint64 wrapX;  // Minimum value to wrap
+    qint64 wrapY;
+};
+
+static constexpr int PerlinN = 0x1000;
+
+// Lattice coordinates are kept within 2^36, so that they and the stitching values
+// still fit into 64 bit integers after being doubled for every octave.
+static constexpr qreal MaxLatticeCoordinate = qreal(Q_INT64_C(1) << 36);
+static_assert(QSvgFeTurbulence::MaxOctaves + 37 < 63);
+
+static inline qint64 toLatticeCoordinate(qreal v)
+{
+    return qint64(qBound(-MaxLatticeCoordinate, v, MaxLatticeCoordinate));
+}
+
+static constexpr long RandM = 2147483647; // 2**31 - 1
+static constexpr long RandA = 16807;      // 7**5; primitive root of m
+static constexpr long RandQ = 127773;     // m / a
+static constexpr long RandR = 2836;       // m % a
+
+static long setupSeed(long seed)
+{
+    if (seed <= 0)
+        seed = -(seed % (RandM - 1)) + 1;
+    if (seed > RandM - 1)
+        seed = RandM - 1;
+    return seed;
+}
+
+static long nextRandom(long seed)
+{
+    long result = RandA * (seed % RandQ) - RandR * (seed / RandQ);
+    if (result <= 0)
+        result += RandM;
+    return result;
+}
+
+static inline qreal sCurve(qreal t)
+{
+    return t * t * (3. - 2. * t);
+}
+
+static inline qreal lerp(qreal t, qreal a, qreal b)
+{
+    return a + t * (b - a);
+}
+
+QSvgFeTurbulence::QSvgFeTurbulence(QSvgNode *parent, const QString &input, const QString &result,
+                                   const QSvgRectF &rect, qreal baseFrequencyX, qreal baseFrequencyY,
+                                   int numOctaves, qreal seed, bool stitchTiles, NoiseType noiseType)
+    : QSvgFeFilterPrimitive(parent, input, result, rect)
+    , m_baseFrequencyX(baseFrequencyX)
+    , m_baseFrequencyY(baseFrequencyY)
+    , m_numOctaves(qBound(0, numOctaves, MaxOctaves))
+    , m_stitchTiles(stitchTiles)
+    , m_noiseType(noiseType)
+{
+    // The lattice and gradient tables only depend on the seed, so they are
+    // set up once here instead of for every rendered frame. A fractional seed
+    // is truncated toward zero, as the reference implementation does.
+    long randomSeed = setupSeed(long(qBound(qreal(-RandM), seed, qreal(RandM))));
+    int i = 0;
+    for (int k = 0; k < 4; ++k) {
+        for (i = 0; i < BSize; ++i) {
+            m_lattice[i] = i;
+            for (int j = 0; j < 2; ++j) {
+                randomSeed = nextRandom(randomSeed);
+                m_gradient[k][i][j] = qreal((randomSeed % (BSize + BSize)) - BSize) / BSize;
+            }
+            const qreal s = qHypot(m_gradient[k][i][0], m_gradient[k][i][1]);
+            if (s > 0) {
+                m_gradient[k][i][0] /= s;
+                m_gradient[k][i][1] /= s;
+            }
+        }
+    }
+    while (--i) {
+        const int k = m_lattice[i];
+        randomSeed = nextRandom(randomSeed);
+        const int j = int(randomSeed % BSize);
+        m_lattice[i] = m_lattice[j];
+        m_lattice[j] = k;
+    }
+    for (i = 0; i < BSize + 2; ++i) {
+        m_lattice[BSize + i] = m_lattice[i];
+        for (int k = 0; k < 4; ++k) {
+            for (int j = 0; j < 2; ++j)
+                m_gradient[k][BSize + i][j] = m_gradient[k][i][j];
+        }
+    }
+}
+
+QSvgNode::Type QSvgFeTurbulence::type() const
+{
+    return QSvgNode::FeTurbulence;
+}
+
+// Evaluates the noise function for all four color channels at once, since
+// the lattice lookup is shared between them.
+void QSvgFeTurbulence::noise2(const qreal vec[2], const StitchInfo *stitch, qreal result[4]) const
+{
+    // Far outside of the lattice range, coordinates have lost most of their fractional
+    // part anyway. Treat them as lattice points, where the noise is zero.
+    if (!(qAbs(vec[0]) < MaxLatticeCoordinate && qAbs(vec[1]) < MaxLatticeCoordinate)) {
+        result[0] = result[1] = result[2] = result[3] = 0;
+        return;
+    }
+
+    qreal t = vec[0] + PerlinN;
+    qint64 bx0 = qint64(t);
+    qint64 bx1 = bx0 + 1;
+    const qreal rx0 = t - bx0;
+    const qreal rx1 = rx0 - 1.;
+    t = vec[1] + PerlinN;
+    qint64 by0 = qint64(t);
+    qint64 by1 = by0 + 1;
+    const qreal ry0 = t - by0;
+    const qreal ry1 = ry0 - 1.;
+
+    // If stitching, adjust lattice points accordingly
+    if (stitch) {
+        if (bx0 >= stitch->wrapX)
+            bx0 -= stitch->width;
+        if (bx1 >= stitch->wrapX)
+            bx1 -= stitch->width;
+        if (by0 >= stitch->wrapY)
+            by0 -= stitch->height;
+        if (by1 >= stitch->wrapY)
+            by1 -= stitch->height;
+    }
+    bx0 &= BMask;
+    bx1 &= BMask;
+    by0 &= BMask;
+    by1 &= BMask;
+
+    const int i = m_lattice[bx0];
+    const int j = m_lattice[bx1];
+    const int b00 = m_lattice[i + int(by0)];
+    const int b10 = m_lattice[j + int(by0)];
+    const int b01 = m_lattice[i + int(by1)];
+    const int b11 = m_lattice[j + int(by1)];
+    const qreal sx = sCurve(rx0);
+    const qreal sy = sCurve(ry0);
+
+    for (int channel = 0; channel < 4; ++channel) {
+        const qreal (*gradient)[2] = m_gradient[channel];
+        qreal u = rx0 * gradient[b00][0] + ry0 * gradient[b00][1];
+        qreal v = rx1 * gradient[b10][0] + ry0 * gradient[b10][1];
+        const qreal a = lerp(sx, u, v);
+        u = rx0 * gradient[b01][0] + ry1 * gradient[b01][1];
+        v = rx1 * gradient[b11][0] + ry1 * gradient[b11][1];
+        const qreal b = lerp(sx, u, v);
+        result[channel] = lerp(sy, a, b);
+    }
+}
+
+QImage QSvgFeTurbulence::apply(const QMap<QString, QImage> &, QPainter *p,
+                               const QRectF &itemBounds, const QRectF &filterBounds,
+                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                               const QRectF &regionOfInterest) const
+{
+    QRectF clipRect = localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits);
+    QRect clipRectGlob = p->transform().mapRect(clipRect).intersected(regionOfInterest).toRect();
+    if (clipRectGlob.isEmpty())
+        return QImage();
+
+    QImage result;
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
+        qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
+        return QImage();
+    }
+    result.setOffset(clipRectGlob.topLeft());
+
+    qreal baseFrequencyX = m_baseFrequencyX;
+    qreal baseFrequencyY = m_baseFrequencyY;
+    StitchInfo initialStitch = {};
+    if (m_stitchTiles) {
+        // When stitching tiled turbulence, the frequencies must be adjusted
+        // so that the tile borders will be continuous.
+        if (baseFrequencyX != 0. && clipRect.width() > 0) {
+            const qreal lowFrequency = floor(clipRect.width() * baseFrequencyX) / clipRect.width();
+            const qreal highFrequency = ceil(clipRect.width() * baseFrequencyX) / clipRect.width();
+            if (lowFrequency > 0 && baseFrequencyX / lowFrequency < highFrequency / baseFrequencyX)
+                baseFrequencyX = lowFrequency;
+            else
+                baseFrequencyX = highFrequency;
+        }
+        if (baseFrequencyY != 0. && clipRect.height() > 0) {
+            const qreal lowFrequency = floor(clipRect.height() * baseFrequencyY) / clipRect.height();
+            const qreal highFrequency = ceil(clipRect.height() * baseFrequencyY) / clipRect.height();
+            if (lowFrequency > 0 && baseFrequencyY / lowFrequency < highFrequency / baseFrequencyY)
+                baseFrequencyY = lowFrequency;
+            else
+                baseFrequencyY = highFrequency;
+        }
+        initialStitch.width = toLatticeCoordinate(clipRect.width() * baseFrequencyX + 0.5);
+        initialStitch.wrapX = toLatticeCoordinate(clipRect.x() * baseFrequencyX + PerlinN
+                                                  + initialStitch.width);
+        initialStitch.height = toLatticeCoordinate(clipRect.height() * baseFrequencyY + 0.5);
+        initialStitch.wrapY = toLatticeCoordinate(clipRect.y() * baseFrequencyY + PerlinN
+                                                  + initialStitch.height);
+    }
+
+    const bool fractalSum = m_noiseType == NoiseType::FractalNoise;
+    const bool highPrecision = isHighPrecision(result);
+    const QTransform inverse = p->transform().inverted();
+    const bool affine = inverse.isAffine();
+
+    for (int j = 0; j < result.height(); ++j) {
+        uchar *resultLine = result.scanLine(j);
+        // The noise is defined in user space, so step through it along the
+        // transformed scan line instead of inverting every pixel position.
+        QPointF point = inverse.map(QPointF(result.offset().x(), result.offset().y() + j));
+        const QPointF step(inverse.m11(), inverse.m12());
+
+        for (int i = 0; i < result.width(); ++i) {
+            if (!affine)
+                point = inverse.map(QPointF(result.offset().x() + i, result.offset().y() + j));
+
+            StitchInfo stitch = initialStitch;
+            qreal vec[2] = { point.x() * baseFrequencyX, point.y() * baseFrequencyY };
+            qreal sum[4] = { 0, 0, 0, 0 };
+            qreal ratio = 1;
+            for (int octave = 0; octave < m_numOctaves; ++octave) {
+                qreal noise[4];
+                noise2(vec, m_stitchTiles ? &stitch : nullptr, noise);
+                for (int channel = 0; channel < 4; ++channel)
+                    sum[channel] += (fractalSum ? noise[channel] : qAbs(noise[channel])) / ratio;
+                vec[0] *= 2;
+                vec[1] *= 2;
+                ratio *= 2;
+                if (m_stitchTiles) {
+                    // Subtracting PerlinN before the multiplication and adding it
+                    // afterward simplifies to subtracting it once.
+                    stitch.width *= 2;
+                    stitch.wrapX = 2 * stitch.wrapX - PerlinN;
+                    stitch.height *= 2;
+                    stitch.wrapY = 2 * stitch.wrapY - PerlinN;
+                }
+            }
+
+            if (highPrecision) {
+                float rgba[4];
+                for (int channel = 0; channel < 4; ++channel) {
+                    const qreal value = fractalSum ? (sum[channel] + 1) / 2 : sum[channel];
+                    rgba[channel] = qBound(0., value, 1.);
+                }
+                reinterpret_cast<QRgbaFloat32 *>(resultLine)[i] =
+                        QRgbaFloat32{rgba[0], rgba[1], rgba[2], rgba[3]}.premultiplied();
+            } else {
+                int rgba[4];
+                for (int channel = 0; channel < 4; ++channel) {
+                    const qreal value = fractalSum ? (sum[channel] * 255 + 255) / 2 : sum[channel] * 255;
+                    rgba[channel] = qBound(0, qRound(value), 255);
+                }
+                reinterpret_cast<QRgb *>(resultLine)[i] = qPremultiply(qRgba(rgba[0], rgba[1], rgba[2], rgba[3]));
+            }
+            point += step;
+        }
+    }
+
+    clipToTransformedBounds(&result, p, clipRect);
+    return result;
+}
+
+QRectF QSvgFeTurbulence::requiredInputRegion(QPainter *, const QRectF &,
+                                             const QRectF &, const QRectF &,
+                                             QtSvg::UnitTypes, QtSvg::UnitTypes) const
+{
+    // Noise is generated from scratch, no input is required
+    return QRectF();
+}
+
+QStringList QSvgFeTurbulence::inputs() const
+{
+    return QStringList();
+}
+
+bool QSvgFeTurbulence::requiresSourceAlpha() const
+{
+    return false;
+}
+
+QSvgFeConvolveMatrix::QSvgFeConvolveMatrix(QSvgNode *parent, const QString &input,
+                                           const QString &result, const QSvgRectF &rect,
+                                           const QSize &order, const QList<qreal> &kernel,
+                                           qreal divisor, qreal bias, const QPoint &target,
+                                           EdgeMode edgeMode, bool preserveAlpha)
+    : QSvgFeFilterPrimitive(parent, input, result, rect)
+    , m_order(order)
+    , m_kernel(kernel)
+    , m_divisor(divisor)
+    , m_bias(bias)
+    , m_target(target)
+    , m_edgeMode(edgeMode)
+    , m_preserveAlpha(preserveAlpha)
+{
+    Q_ASSERT(m_kernel.size() == m_order.width() * m_order.height());
+    Q_ASSERT(m_divisor != 0);
+}
+
+QSvgNode::Type QSvgFeConvolveMatrix::type() const
+{
+    return QSvgNode::FeConvolvematrix;
+}
+
+QRectF QSvgFeConvolveMatrix::requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                                                 const QRectF &itemBounds, const QRectF &filterBounds,
+                                                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const
+{
+    // Pixels outside of the subregion are never read: they are either clamped
+    // or wrapped into it, or treated as transparent.
+    const QRectF subRegion = globalSubRegion(p, itemBounds, filterBounds, primitiveUnits, filterUnits);
+    if (m_edgeMode == EdgeMode::Wrap)
+        return subRegion;
+
+    return outputRegion.adjusted(-m_target.x(), -m_target.y(),
+                                 m_order.width() - 1 - m_target.x(),
+                                 m_order.height() - 1 - m_target.y()).intersected(subRegion);
+}
+
+// Computes the dot product of the kernel with the neighbourhood starting at pixels,
+// for all four channels at once
+static inline void convolvePixel(const float *pixels, qsizetype width, const float *kernel,
+                                 int orderX, int orderY, float sum[4])
+{
+#ifdef __SSE2__
+    __m128 acc = _mm_setzero_ps();
+    for (int ky = 0; ky < orderY; ++ky) {
+        const float *row = pixels + qsizetype(ky) * width * 4;
+        for (int kx = 0; kx < orderX; ++kx, row += 4, ++kernel)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(row), _mm_set1_ps(*kernel)));
+    }
+    _mm_storeu_ps(sum, acc);
+#else
+    sum[0] = sum[1] = sum[2] = sum[3] = 0;
+    for (int ky = 0; ky < orderY; ++ky) {
+        const float *row = pixels + qsizetype(ky) * width * 4;
+        for (int kx = 0; kx < orderX; ++kx, row += 4, ++kernel) {
+            sum[0] += row[0] * *kernel;
+            sum[1] += row[1] * *kernel;
+            sum[2] += row[2] * *kernel;
+            sum[3] += row[3] * *kernel;
+        }
+    }
+#endif
+}
+
+QImage QSvgFeConvolveMatrix::apply(const QMap<QString, QImage> &sources, QPainter *p,
+                                   const QRectF &itemBounds, const QRectF &filterBounds,
+                                   QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                                   const QRectF &regionOfInterest) const
+{
+    if (!sources.contains(m_input))
+        return QImage();
+    const QImage &source = sources[m_input];
+    Q_ASSERT(source.format() == bufferFormat());
+
+    QRectF clipRect = localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits);
+    const QRect subRegion = p->transform().mapRect(clipRect).toRect();
+    QRect clipRectGlob = subRegion.intersected(regionOfInterest.toAlignedRect());
+    if (clipRectGlob.isEmpty())
+        return QImage();
+
+    QImage result;
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
+        qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
+        return QImage();
+    }
+    result.setOffset(clipRectGlob.topLeft());
+
+    const int orderX = m_order.width();
+    const int orderY = m_order.height();
+
+    // Resolve the edge mode once while copying the neighbourhood of the output into
+    // a padded buffer, so that the convolution itself does not need any bounds checks.
+    const QRect paddedRect = clipRectGlob.adjusted(-m_target.x(), -m_target.y(),
+                                                   orderX - 1 - m_target.x(),
+                                                   orderY - 1 - m_target.y());
+    const int paddedWidth = paddedRect.width();
+    QVarLengthArray<float, 1024> padded(qsizetype(paddedWidth) * paddedRect.height() * 4);
+
+    // Returns the position in source to read for (x, y), or an invalid position for transparent pixels
+    auto sourcePosition = [&](int x, int y) -> QPoint {
+        if (!subRegion.contains(x, y)) {
+            switch (m_edgeMode) {
+            case EdgeMode::Duplicate:
+                x = qBound(subRegion.left(), x, subRegion.right());
+                y = qBound(subRegion.top(), y, subRegion.bottom());
+                break;
+            case EdgeMode::Wrap:
+                x = subRegion.left() + ((x - subRegion.left()) % subRegion.width() + subRegion.width())
+                        % subRegion.width();
+                y = subRegion.top() + ((y - subRegion.top()) % subRegion.height() + subRegion.height())
+                        % subRegion.height();
+                break;
+            case EdgeMode::None:
+                return QPoint(-1, -1);
+            }
+        }
+        return QPoint(x, y) - source.offset();
+    };
+
+    // Both buffer formats are convolved in the [0, 255] range
+    const bool highPrecision = isHighPrecision(result);
+    float *paddedPixel = padded.data();
+    for (int y = paddedRect.top(); y <= paddedRect.bottom(); ++y) {
+        for (int x = paddedRect.left(); x <= paddedRect.right(); ++x) {
+            const QPoint pos = sourcePosition(x, y);
+            const bool inside = source.rect().contains(pos);
+            if (highPrecision) {
+                QRgbaFloat32 pixel = inside
+                        ? reinterpret_cast<const QRgbaFloat32 *>(source.constScanLine(pos.y()))[pos.x()]
+                        : QRgbaFloat32{0, 0, 0, 0};
+                if (m_preserveAlpha)
+                    pixel = pixel.unpremultiplied();
+                *paddedPixel++ = pixel.r * 255;
+                *paddedPixel++ = pixel.g * 255;
+                *paddedPixel++ = pixel.b * 255;
+                *paddedPixel++ = pixel.a * 255;
+            } else {
+                QRgb pixel = inside ? reinterpret_cast<const QRgb *>(source.constScanLine(pos.y()))[pos.x()]
+                                    : qRgba(0, 0, 0, 0);
+                if (m_preserveAlpha)
+                    pixel = qUnpremultiply(pixel);
+                *paddedPixel++ = qRed(pixel);
+                *paddedPixel++ = qGreen(pixel);
+                *paddedPixel++ = qBlue(pixel);
+                *paddedPixel++ = qAlpha(pixel);
+            }
+        }
+    }
+
+    // The kernel is rotated by 180 degrees in the definition of the convolution. Flip
+    // it up front and fold the divisor in, so that the inner loop is a plain dot product.
+    QVarLengthArray<float, 25> kernel(m_kernel.size());
+    for (qsizetype k = 0; k < m_kernel.size(); ++k)
+        kernel[k] = m_kernel.at(m_kernel.size() - 1 - k) / m_divisor;
+    const float bias = m_bias * 255;
+
+    for (int j = 0; j < result.height(); ++j) {
+        QRgb *resultLine = reinterpret_cast<QRgb *>(result.scanLine(j));
+        QRgbaFloat32 *resultLineF = reinterpret_cast<QRgbaFloat32 *>(result.scanLine(j));
+        for (int i = 0; i < result.width(); ++i) {
+            float sum[4];
+            convolvePixel(padded.constData() + (qsizetype(j) * paddedWidth + i) * 4, paddedWidth,
+                          kernel.constData(), orderX, orderY, sum);
+
+            if (highPrecision) {
+                float rgba[4];
+                if (m_preserveAlpha) {
+                    const float *center = padded.constData()
+                            + (qsizetype(j + m_target.y()) * paddedWidth + i + m_target.x()) * 4;
+                    for (int c = 0; c < 3; ++c)
+                        rgba[c] = qBound(0.f, sum[c] + bias, 255.f);
+                    rgba[3] = center[3];
+                    resultLineF[i] = QRgbaFloat32{rgba[0] / 255, rgba[1] / 255,
+                                                  rgba[2] / 255, rgba[3] / 255}.premultiplied();
+                } else {
+                    rgba[3] = qBound(0.f, sum[3] + bias, 255.f);
+                    for (int c = 0; c < 3; ++c)
+                        rgba[c] = qBound(0.f, sum[c] + float(m_bias) * rgba[3], rgba[3]);
+                    resultLineF[i] = QRgbaFloat32{rgba[0] / 255, rgba[1] / 255,
+                                                  rgba[2] / 255, rgba[3] / 255};
+                }
+            } else if (m_preserveAlpha) {
+                const float *center = padded.constData()
+                        + (qsizetype(j + m_target.y()) * paddedWidth + i + m_target.x()) * 4;
+                const int a = qRound(center[3]);
+                resultLine[i] = qPremultiply(qRgba(qBound(0, qRound(sum[0] + bias), 255),
+                                                   qBound(0, qRound(sum[1] + bias), 255),
+                                                   qBound(0, qRound(sum[2] + bias), 255),
+                                                   a));
+            } else {
+                // The bias is applied to premultiplied colors, see Filter Effects Module Level 1
+                const float a = qBound(0.f, sum[3] + bias, 255.f);
+                const float colorBias = m_bias * a;
+                resultLine[i] = qRgba(qRound(qBound(0.f, sum[0] + colorBias, a)),
+                                      qRound(qBound(0.f, sum[1] + colorBias, a)),
+                                      qRound(qBound(0.f, sum[2] + colorBias, a)),
+                                      qRound(a));
+            }
+        }
+    }
+
+    clipToTransformedBounds(&result, p, clipRect);
+    return result;
+}
+
+QSvgFeMorphology::QSvgFeMorphology(QSvgNode *parent, const QString &input, const QString &result,
+                                   const QSvgRectF &rect, Operator op, qreal radiusX, qreal radiusY)
+    : QSvgFeFilterPrimitive(parent, input, result, rect)
+    , m_operator(op)
+    , m_radiusX(radiusX)
+    , m_radiusY(radiusY)
+{
+
+}
+
+QSvgNode::Type QSvgFeMorphology::type() const
+{
+    return QSvgNode::FeMorphology;
+}
+
+QSize QSvgFeMorphology::globalRadius(QPainter *p, const QRectF &itemBounds,
+                                     QtSvg::UnitTypes primitiveUnits) const
+{
+    const QTransform scaleXr = blurScaleTransform(p->transform());
+
+    qreal radiusX = scaleXr.m11() * m_radiusX;
+    qreal radiusY = scaleXr.m22() * m_radiusY;
+    if (primitiveUnits == QtSvg::UnitTypes::objectBoundingBox) {
+        radiusX *= itemBounds.width();
+        radiusY *= itemBounds.height();
+    }
+    return QSize(qMax(0, qRound(radiusX)), qMax(0, qRound(radiusY)));
+}
+
+QRectF QSvgFeMorphology::requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                                             const QRectF &itemBounds, const QRectF &,
+                                             QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes) const
+{
+    if (m_radiusX <= 0 || m_radiusY <= 0)
+        return outputRegion;
+
+    const QSize r = globalRadius(p, itemBounds, primitiveUnits);
+    return outputRegion.adjusted(-r.width(), -r.height(), r.width(), r.height());
+}
+
+// Per channel minimum and maximum of two premultiplied pixels. The result
+// is premultiplied again, since each color channel stays below its alpha.
+struct QSvgErodeOperator
+{
+    static inline QRgb combine(QRgb a, QRgb b)
+    {
+        return qMin(a & 0xff000000, b & 0xff000000) | qMin(a & 0x00ff0000, b & 0x00ff0000)
+             | qMin(a & 0x0000ff00, b & 0x0000ff00) | qMin(a & 0x000000ff, b & 0x000000ff);
+    }
+    static inline QRgbaFloat32 combine(QRgbaFloat32 a, QRgbaFloat32 b)
+    {
+        return QRgbaFloat32{qMin(a.r, b.r), qMin(a.g, b.g), qMin(a.b, b.b), qMin(a.a, b.a)};
+    }
+};
+
+struct QSvgDilateOperator
+{
+    static inline QRgb combine(QRgb a, QRgb b)
+    {
+        return qMax(a & 0xff000000, b & 0xff000000) | qMax(a & 0x00ff0000, b & 0x00ff0000)
+             | qMax(a & 0x0000ff00, b & 0x0000ff00) | qMax(a & 0x000000ff, b & 0x000000ff);
+    }
+    static inline QRgbaFloat32 combine(QRgbaFloat32 a, QRgbaFloat32 b)
+    {
+        return QRgbaFloat32{qMax(a.r, b.r), qMax(a.g, b.g), qMax(a.b, b.b), qMax(a.a, b.a)};
+    }
+};
+
+// Both passes use the van Herk/Gil-Werman algorithm: the input is split into blocks of
+// the window size, and prefix and suffix extrema within each block combine to the
+// extremum of any window in two steps. The cost per pixel is independent of the radius.
+
+// Reduces each row of src to the extrema over windows of 2 * r + 1 pixels. dst is
+// 2 * r pixels narrower than src.
+template <typename Operator, typename Pixel>
+static void morphologyRows(const QImage &src, QImage *dst, int r)
+{
+    const int n = src.width();
+    const int w = 2 * r + 1;
+    QVarLengthArray<Pixel, 256> prefix(n);
+    QVarLengthArray<Pixel, 256> suffix(n);
+
+    for (int y = 0; y < src.height(); ++y) {
+        const Pixel *in = reinterpret_cast<const Pixel *>(src.constScanLine(y));
+        Pixel *out = reinterpret_cast<Pixel *>(dst->scanLine(y));
+
+        for (int block = 0; block < n; block += w) {
+            const int end = qMin(block + w, n);
+            prefix[block] = in[block];
+            for (int x = block + 1; x < end; ++x)
+                prefix[x] = Operator::combine(prefix[x - 1], in[x]);
+            suffix[end - 1] = in[end - 1];
+            for (int x = end - 2; x >= block; --x)
+                suffix[x] = Operator::combine(suffix[x + 1], in[x]);
+        }
+        for (int x = 0; x < dst->width(); ++x)
+            out[x] = Operator::combine(suffix[x], prefix[x + w - 1]);
+    }
+}
+
+// Reduces each column of src to the extrema over windows of 2 * r + 1 pixels. dst is
+// 2 * r pixels shorter than src. The passes run over whole rows to keep memory access
+// sequential, and src is overwritten with the suffix extrema.
+template <typename Operator, typename Pixel>
+static bool morphologyColumns(QImage *src, QImage *dst, int r)
+{
+    const int n = src->height();
+    const int width = src->width();
+    const int w = 2 * r + 1;
+
+    QImage prefix;
+    if (!QImageIOHandler::allocateImage(src->size(), src->format(), &prefix))
+        return false;
+
+    for (int block = 0; block < n; block += w) {
+        const int end = qMin(block + w, n);
+        memcpy(prefix.scanLine(block), src->constScanLine(block), width * sizeof(Pixel));
+        for (int y = block + 1; y < end; ++y) {
+            const Pixel *previous = reinterpret_cast<const Pixel *>(prefix.constScanLine(y - 1));
+            const Pixel *in = reinterpret_cast<const Pixel *>(src->constScanLine(y));
+            Pixel *out = reinterpret_cast<Pixel *>(prefix.scanLine(y));
+            for (int x = 0; x < width; ++x)
+                out[x] = Operator::combine(previous[x], in[x]);
+        }
+        for (int y = end - 2; y >= block; --y) {
+            const Pixel *next = reinterpret_cast<const Pixel *>(src->constScanLine(y + 1));
+            Pixel *inout = reinterpret_cast<Pixel *>(src->scanLine(y));
+            for (int x = 0; x < width; ++x)
+                inout[x] = Operator::combine(next[x], inout[x]);
+        }
+    }
+
+    for (int y = 0; y < dst->height(); ++y) {
+        const Pixel *suffix = reinterpret_cast<const Pixel *>(src->constScanLine(y));
+        const Pixel *prefixLine = reinterpret_cast<const Pixel *>(prefix.constScanLine(y + w - 1));
+        Pixel *out = reinterpret_cast<Pixel *>(dst->scanLine(y));
+        for (int x = 0; x < width; ++x)
+            out[x] = Operator::combine(suffix[x], prefixLine[x]);
+    }
+    return true;
+}
+
+template <typename Operator, typename Pixel>
+static bool morphology(const QImage &work, QImage *rows, QImage *result, const QSize &r)
+{
+    morphologyRows<Operator, Pixel>(work, rows, r.width());
+    return morphologyColumns<Operator, Pixel>(rows, result, r.height());
+}
+
+QImage QSvgFeMorphology::apply(const QMap<QString, QImage> &sources, QPainter *p,
+                               const QRectF &itemBounds, const QRectF &filterBounds,
+                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                               const QRectF &regionOfInterest) const
+{
+    if (!sources.contains(m_input))
+        return QImage();
+    const QImage &source = sources[m_input];
+    Q_ASSERT(source.format() == bufferFormat());
+
+    QRectF clipRect = localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits);
+    QRect clipRectGlob = p->transform().mapRect(clipRect).intersected(regionOfInterest).toRect();
+    if (clipRectGlob.isEmpty())
+        return QImage();
+
+    QImage result;
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
+        qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
+        return QImage();
+    }
+    result.setOffset(clipRectGlob.topLeft());
+    result.fill(Qt::transparent);
+
+    // A negative or zero radius disables the effect, passing the input through
+    const QSize r = (m_radiusX <= 0 || m_radiusY <= 0) ? QSize(0, 0)
+                                                       : globalRadius(p, itemBounds, primitiveUnits);
+    if (r.isNull()) {
+        QPainter copyPainter(&result);
+        copyPainter.drawImage(source.offset() - result.offset(), source);
+        copyPainter.end();
+        clipToTransformedBounds(&result, p, clipRect);
+        return result;
+    }
+
+    const QRect workRect = clipRectGlob.adjusted(-r.width(), -r.height(), r.width(), r.height());
+    QImage work;
+    QImage rows;
+    if (!QImageIOHandler::allocateImage(workRect.size(), result.format(), &work)
+        || !QImageIOHandler::allocateImage(QSize(clipRectGlob.width(), workRect.height()),
+                                           result.format(), &rows)) {
+        qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
+        return QImage();
+    }
+    work.fill(Qt::transparent);
+
+    QPainter copyPainter(&work);
+    copyPainter.setCompositionMode(QPainter::CompositionMode_Source);
+    copyPainter.drawImage(source.offset() - workRect.topLeft(), source);
+    copyPainter.end();
+
+    bool ok;
+    if (isHighPrecision(result)) {
+        ok = m_operator == Operator::Erode
+                ? morphology<QSvgErodeOperator, QRgbaFloat32>(work, &rows, &result, r)
+                : morphology<QSvgDilateOperator, QRgbaFloat32>(work, &rows, &result, r);
+    } else {
+        ok = m_operator == Operator::Erode
+                ? morphology<QSvgErodeOperator, QRgb>(work, &rows, &result, r)
+                : morphology<QSvgDilateOperator, QRgb>(work, &rows, &result, r);
+    }
+    if (!ok) {
+        qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
+        return QImage();
+    }
+
+    clipToTransformedBounds(&result, p, clipRect);
+    return result;
+}
+
+QSvgFeDisplacementMap::QSvgFeDisplacementMap(QSvgNode *parent, const QString &input,
+                                             const QString &result, const QSvgRectF &rect,
+                                             const QString &input2, qreal scale,
+                                             Channel xChannel, Channel yChannel)
+    : QSvgFeFilterPrimitive(parent, input, result, rect)
+    , m_input2(input2)
+    , m_scale(scale)
+    , m_xChannel(xChannel)
+    , m_yChannel(yChannel)
+{
+
+}
+
+QSvgNode::Type QSvgFeDisplacementMap::type() const
+{
+    return QSvgNode::FeDisplacementmap;
+}
+
+// Maps the channel values of in2, shifted to [-0.5, 0.5], to a displacement in device pixels
+QTransform QSvgFeDisplacementMap::displacementTransform(QPainter *p, const QRectF &itemBounds,
+                                                        QtSvg::UnitTypes primitiveUnits) const
+{
+    qreal scaleX = m_scale;
+    qreal scaleY = m_scale;
+    if (primitiveUnits == QtSvg::UnitTypes::objectBoundingBox) {
+        scaleX *= itemBounds.width();
+        scaleY *= itemBounds.height();
+    }
+    const QTransform &xf = p->transform();
+    return QTransform(xf.m11() * scaleX, xf.m12() * scaleX,
+                      xf.m21() * scaleY, xf.m22() * scaleY,
+                      0, 0);
+}
+
+QRectF QSvgFeDisplacementMap::requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                                                  const QRectF &itemBounds, const QRectF &,
+                                                  QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes) const
+{
+    const QRectF reach = displacementTransform(p, itemBounds, primitiveUnits)
+            .mapRect(QRectF(-0.5, -0.5, 1, 1));
+    return outputRegion.adjusted(floor(reach.left()), floor(reach.top()),
+                                 ceil(reach.right()), ceil(reach.bottom()));
+}
+
+QImage QSvgFeDisplacementMap::apply(const QMap<QString, QImage> &sources, QPainter *p,
+                                    const QRectF &itemBounds, const QRectF &filterBounds,
+                                    QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                                    const QRectF &regionOfInterest) const
+{
+    if (!sources.contains(m_input))
+        return QImage();
+    if (!sources.contains(m_input2))
+        return QImage();
+    const QImage &source = sources[m_input];
+    const QImage &map = sources[m_input2];
+    Q_ASSERT(source.format() == bufferFormat());
+    Q_ASSERT(map.format() == bufferFormat());
+
+    QRectF clipRect = localSubRegion(itemBounds, filterBounds, primitiveUnits, filterUnits);
+    QRect clipRectGlob = p->transform().mapRect(clipRect).intersected(regionOfInterest).toRect();
+    if (clipRectGlob.isEmpty())
+        return QImage();
+
+    QImage result;
+    if (!QImageIOHandler::allocateImage(clipRectGlob.size(), bufferFormat(), &result)) {
+        qCWarning(lcSvgDraw) << "The requested filter buffer is too big, ignoring";
+        return QImage();
+    }
+    result.setOffset(clipRectGlob.topLeft());
+    result.fill(Qt::transparent);
+
+    // Channel values in the range [0, 1]
+    auto channelValue = [](const QImage &image, int x, int y, Channel channel, bool unpremultiply) -> qreal {
+        if (!image.rect().contains(x, y))
+            return 0;
+        if (isHighPrecision(image)) {
+            QRgbaFloat32 pixel = reinterpret_cast<const QRgbaFloat32 *>(image.constScanLine(y))[x];
+            if (unpremultiply)
+                pixel = pixel.unpremultiplied();
+            switch (channel) {
+            case Channel::R: return pixel.r;
+            case Channel::G: return pixel.g;
+            case Channel::B: return pixel.b;
+            case Channel::A: return pixel.a;
+            }
+            return 0;
+        }
+        QRgb pixel = reinterpret_cast<const QRgb *>(image.constScanLine(y))[x];
+        if (unpremultiply)
+            pixel = qUnpremultiply(pixel);
+        switch (channel) {
+        case Channel::R: return qRed(pixel) / 255.;
+        case Channel::G: return qGreen(pixel) / 255.;
+        case Channel::B: return qBlue(pixel) / 255.;
+        case Channel::A: return qAlpha(pixel) / 255.;
+        }
+        return 0;
+    };
+
+    const QTransform displacement = displacementTransform(p, itemBounds, primitiveUnits);
+    const bool needsUnpremultiply = m_xChannel != Channel::A || m_yChannel != Channel::A;
+    const qsizetype bytesPerPixel = result.depth() / 8;
+
+    for (int j = 0; j < result.height(); ++j) {
+        const int y = result.offset().y() + j;
+        const int mapY = y - map.offset().y();
+        uchar *resultLine = result.scanLine(j);
+
+        for (int i = 0; i < result.width(); ++i) {
+            const int x = result.offset().x() + i;
+            const int mapX = x - map.offset().x();
+
+            const QPointF shift = displacement.map(
+                    QPointF(channelValue(map, mapX, mapY, m_xChannel, needsUnpremultiply) - 0.5,
+                            channelValue(map, mapX, mapY, m_yChannel, needsUnpremultiply) - 0.5));
+            const int sourceX = qFloor(x + 0.5 + shift.x()) - source.offset().x();
+            const int sourceY = qFloor(y + 0.5 + shift.y()) - source.offset().y();
+            if (sourceX >= 0 && sourceX < source.width() && sourceY >= 0 && sourceY < source.height()) {
+                memcpy(resultLine + i * bytesPerPixel,
+                       source.constScanLine(sourceY) + sourceX * bytesPerPixel, bytesPerPixel);
+            }
+        }
+    }
+
+    clipToTransformedBounds(&result, p, clipRect);
+    return result;
+}
+
+QStringList QSvgFeDisplacementMap::inputs() const
+{
+    return QStringList{m_input, m_input2};
+}
+
+bool QSvgFeDisplacementMap::requiresSourceAlpha() const
+{
+    if (QSvgFeFilterPrimitive::requiresSourceAlpha())
+        return true;
+    return m_input2 == QLatin1StringView("SourceAlpha");
+}
+
 QSvgFeUnsupported::QSvgFeUnsupported(QSvgNode *parent, const QString &input, const QString &result,
                          const QSvgRectF &rect)
     : QSvgFeFilterPrimitive(parent, input, result, rect)
@@ -859,7 +2103,7 @@ QSvgNode::Type QSvgFeUnsupported::type() const
 
 QImage QSvgFeUnsupported::apply(const QMap<QString, QImage> &,
                           QPainter *, const QRectF &, const QRectF &,
-                          QtSvg::UnitTypes, QtSvg::UnitTypes) const
+                          QtSvg::UnitTypes, QtSvg::UnitTypes, const QRectF &) const
 {
     qCDebug(lcSvgDraw) << "Unsupported filter primitive should not be applied.";
     return QImage();
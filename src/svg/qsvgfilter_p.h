@@ -43,7 +43,12 @@ public:
     void clipToTransformedBounds(QImage *buffer, QPainter *p, const QRectF &localRect) const;
     virtual QImage apply(const QMap<QString, QImage> &sources,
                          QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                         QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const = 0;
+                         QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                         const QRectF &regionOfInterest) const = 0;
+    virtual QRectF requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                                       const QRectF &itemBounds, const QRectF &filterBounds,
+                                       QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const;
+    virtual QStringList inputs() const;
     virtual bool requiresSourceAlpha() const;
     QString input() const {
         return m_input;
@@ -55,6 +60,10 @@ public:
     static const QSvgFeFilterPrimitive *castToFilterPrimitive(const QSvgNode *node);
 
 protected:
+    const QSvgFilterContainer *filterContainer() const;
+    QImage::Format bufferFormat() const;
+    bool usesLinearLight() const;
+
     QString m_input;
     QString m_result;
     QSvgRectF m_rect;
@@ -80,7 +89,8 @@ public:
     Type type() const override;
     QImage apply(const QMap<QString, QImage> &sources,
                  QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
 private:
     Matrix m_matrix;
 };
@@ -100,8 +110,17 @@ public:
     Type type() const override;
     QImage apply(const QMap<QString, QImage> &sources,
                  QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QRectF requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                               const QRectF &itemBounds, const QRectF &filterBounds,
+                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
 private:
+    QSize boxSize(QPainter *p, const QRectF &itemBounds, QtSvg::UnitTypes primitiveUnits) const;
+    QRectF scaledInputRegion(QPainter *p, const QRectF &outputRegion,
+                             const QRectF &itemBounds, const QRectF &filterBounds,
+                             QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const;
+
     qreal m_stdDeviationX;
     qreal m_stdDeviationY;
     EdgeMode m_edgemode; // TODO: Unused. Start using it when there's a reference implementation.
@@ -115,8 +134,14 @@ public:
     Type type() const override;
     QImage apply(const QMap<QString, QImage> &sources,
                  QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QRectF requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                               const QRectF &itemBounds, const QRectF &filterBounds,
+                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
 private:
+    QPoint globalOffset(QPainter *p, const QRectF &itemBounds, QtSvg::UnitTypes primitiveUnits) const;
+
     qreal m_dx;
     qreal m_dy;
 };
@@ -129,7 +154,9 @@ public:
     Type type() const override;
     QImage apply(const QMap<QString, QImage> &sources,
                  QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QStringList inputs() const override;
     bool requiresSourceAlpha() const override;
 };
 
@@ -141,7 +168,8 @@ public:
     Type type() const override;
     QImage apply(const QMap<QString, QImage> &sources,
                  QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
 };
 
 class Q_SVG_EXPORT QSvgFeComposite : public QSvgFeFilterPrimitive
@@ -161,7 +189,9 @@ public:
     Type type() const override;
     QImage apply(const QMap<QString, QImage> &sources,
                  QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QStringList inputs() const override;
     bool requiresSourceAlpha() const override;
 private:
     QString m_input2;
@@ -177,7 +207,11 @@ public:
     Type type() const override;
     QImage apply(const QMap<QString, QImage> &sources,
                  QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QRectF requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                               const QRectF &itemBounds, const QRectF &filterBounds,
+                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
 private:
     QColor m_color;
 };
@@ -197,7 +231,9 @@ public:
     Type type() const override;
     QImage apply(const QMap<QString, QImage> &sources,
                  QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QStringList inputs() const override;
     bool requiresSourceAlpha() const override;
 private:
     QString m_input2;
@@ -205,6 +241,133 @@ private:
 
 };
 
+class Q_SVG_EXPORT QSvgFeTurbulence : public QSvgFeFilterPrimitive
+{
+public:
+    enum class NoiseType : quint8 {
+        Turbulence,
+        FractalNoise
+    };
+    // Further octaves contribute less than the precision of the result
+    static constexpr int MaxOctaves = 24;
+
+    QSvgFeTurbulence(QSvgNode *parent, const QString &input, const QString &result,
+                     const QSvgRectF &rect, qreal baseFrequencyX, qreal baseFrequencyY,
+                     int numOctaves, qreal seed, bool stitchTiles, NoiseType noiseType);
+    Type type() const override;
+    QImage apply(const QMap<QString, QImage> &sources,
+                 QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QRectF requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                               const QRectF &itemBounds, const QRectF &filterBounds,
+                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+    QStringList inputs() const override;
+    bool requiresSourceAlpha() const override;
+private:
+    struct StitchInfo;
+    void noise2(const qreal vec[2], const StitchInfo *stitch, qreal result[4]) const;
+
+    static constexpr int BSize = 0x100;
+    static constexpr int BMask = 0xff;
+
+    qreal m_baseFrequencyX;
+    qreal m_baseFrequencyY;
+    int m_numOctaves;
+    bool m_stitchTiles;
+    NoiseType m_noiseType;
+
+    int m_lattice[BSize + BSize + 2];
+    qreal m_gradient[4][BSize + BSize + 2][2];
+};
+
+class Q_SVG_EXPORT QSvgFeConvolveMatrix : public QSvgFeFilterPrimitive
+{
+public:
+    enum class EdgeMode : quint8 {
+        Duplicate,
+        Wrap,
+        None
+    };
+    QSvgFeConvolveMatrix(QSvgNode *parent, const QString &input, const QString &result,
+                         const QSvgRectF &rect, const QSize &order, const QList<qreal> &kernel,
+                         qreal divisor, qreal bias, const QPoint &target, EdgeMode edgeMode,
+                         bool preserveAlpha);
+    Type type() const override;
+    QImage apply(const QMap<QString, QImage> &sources,
+                 QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QRectF requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                               const QRectF &itemBounds, const QRectF &filterBounds,
+                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+private:
+    QSize m_order;
+    QList<qreal> m_kernel;
+    qreal m_divisor;
+    qreal m_bias;
+    QPoint m_target;
+    EdgeMode m_edgeMode;
+    bool m_preserveAlpha;
+};
+
+class Q_SVG_EXPORT QSvgFeMorphology : public QSvgFeFilterPrimitive
+{
+public:
+    enum class Operator : quint8 {
+        Erode,
+        Dilate
+    };
+    QSvgFeMorphology(QSvgNode *parent, const QString &input, const QString &result,
+                     const QSvgRectF &rect, Operator op, qreal radiusX, qreal radiusY);
+    Type type() const override;
+    QImage apply(const QMap<QString, QImage> &sources,
+                 QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QRectF requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                               const QRectF &itemBounds, const QRectF &filterBounds,
+                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+private:
+    QSize globalRadius(QPainter *p, const QRectF &itemBounds, QtSvg::UnitTypes primitiveUnits) const;
+
+    Operator m_operator;
+    qreal m_radiusX;
+    qreal m_radiusY;
+};
+
+class Q_SVG_EXPORT QSvgFeDisplacementMap : public QSvgFeFilterPrimitive
+{
+public:
+    enum class Channel : quint8 {
+        R,
+        G,
+        B,
+        A
+    };
+    QSvgFeDisplacementMap(QSvgNode *parent, const QString &input, const QString &result,
+                          const QSvgRectF &rect, const QString &input2, qreal scale,
+                          Channel xChannel, Channel yChannel);
+    Type type() const override;
+    QImage apply(const QMap<QString, QImage> &sources,
+                 QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
+    QRectF requiredInputRegion(QPainter *p, const QRectF &outputRegion,
+                               const QRectF &itemBounds, const QRectF &filterBounds,
+                               QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+    QStringList inputs() const override;
+    bool requiresSourceAlpha() const override;
+private:
+    QTransform displacementTransform(QPainter *p, const QRectF &itemBounds,
+                                     QtSvg::UnitTypes primitiveUnits) const;
+
+    QString m_input2;
+    qreal m_scale;
+    Channel m_xChannel;
+    Channel m_yChannel;
+};
+
 class Q_SVG_EXPORT QSvgFeUnsupported : public QSvgFeFilterPrimitive
 {
 public:
@@ -213,7 +376,8 @@ public:
     Type type() const override;
     QImage apply(const QMap<QString, QImage> &sources,
                  QPainter *p, const QRectF &itemBounds, const QRectF &filterBounds,
-                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits) const override;
+                 QtSvg::UnitTypes primitiveUnits, QtSvg::UnitTypes filterUnits,
+                 const QRectF &regionOfInterest) const override;
 };
 
 QT_END_NAMESPACE
@@ -8,17 +8,30 @@
 #include "qdebug.h"
 #include "qpicture.h"
 
+#include <algorithm>
+
 QT_BEGIN_NAMESPACE
 
-QSvgGlyph::QSvgGlyph(QChar unicode, const QPainterPath &path, qreal horizAdvX)
+QSvgGlyph::QSvgGlyph(const QString &unicode, const QPainterPath &path, qreal horizAdvX)
     : m_unicode(unicode), m_path(path), m_horizAdvX(horizAdvX)
 {
 
 }
 
+// The combined paths of text runs are limited per font, in path elements
+static constexpr qsizetype textRunCacheBudget = 64 * 1024;
+
+static char32_t codePointAt(QStringView str, qsizetype pos)
+{
+    const QChar c = str.at(pos);
+    if (c.isHighSurrogate() && pos + 1 < str.size() && str.at(pos + 1).isLowSurrogate())
+        return QChar::surrogateToUcs4(c, str.at(pos + 1));
+    return c.unicode();
+}
 
 QSvgFont::QSvgFont(qreal horizAdvX)
     : m_horizAdvX(horizAdvX)
+    , m_textRuns(textRunCacheBudget)
 {
 }
 
@@ -29,10 +42,96 @@ QString QSvgFont::familyName() const
 }
 
 
-void QSvgFont::addGlyph(QChar unicode, const QPainterPath &path, qreal horizAdvX )
+void QSvgFont::addGlyph(const QString &unicode, const QPainterPath &path, qreal horizAdvX )
 {
-    m_glyphs.insert(unicode, QSvgGlyph(unicode, path,
-                                       (horizAdvX==-1)?m_horizAdvX:horizAdvX));
+    const QSvgGlyph glyph(unicode, path, (horizAdvX == -1) ? m_horizAdvX : horizAdvX);
+    m_textRuns.clear();
+
+    if (unicode.isEmpty()) {
+        if (m_missingGlyph < 0) {
+            m_missingGlyph = m_glyphs.size();
+            m_glyphs.append(glyph);
+        } else {
+            m_glyphs[m_missingGlyph] = glyph;
+        }
+        return;
+    }
+
+    // A glyph for the same string replaces the previous one
+    QList<qsizetype> &candidates = m_glyphIndex[codePointAt(unicode, 0)];
+    for (qsizetype index : std::as_const(candidates)) {
+        if (m_glyphs.at(index).m_unicode == unicode) {
+            m_glyphs[index] = glyph;
+            return;
+        }
+    }
+
+    candidates.append(m_glyphs.size());
+    m_glyphs.append(glyph);
+    std::stable_sort(candidates.begin(), candidates.end(), [this](qsizetype a, qsizetype b) {
+        return m_glyphs.at(a).m_unicode.size() > m_glyphs.at(b).m_unicode.size();
+    });
+}
+
+// Returns the index of the glyph for the text at pos, or -1 if there is none, and
+// advances pos past the characters it represents
+qsizetype QSvgFont::findGlyph(QStringView str, qsizetype *pos) const
+{
+    const char32_t codePoint = codePointAt(str, *pos);
+    const auto it = m_glyphIndex.constFind(codePoint);
+    if (it != m_glyphIndex.cend()) {
+        const QStringView rest = str.sliced(*pos);
+        for (qsizetype index : it.value()) {
+            const QString &unicode = m_glyphs.at(index).m_unicode;
+            if (rest.startsWith(unicode)) {
+                *pos += unicode.size();
+                return index;
+            }
+        }
+    }
+
+    *pos += QChar::requiresSurrogates(codePoint) ? 2 : 1;
+    return m_missingGlyph;
+}
+
+QSvgFont::TextRun QSvgFont::textRun(const QString &str) const
+{
+    if (const TextRun *cached = m_textRuns.object(str))
+        return *cached;
+
+    TextRun run;
+    run.path.setFillRule(Qt::WindingFill);
+    QRectF batchBounds;
+    qreal x = 0;
+    for (qsizetype pos = 0; pos < str.size(); ) {
+        const qsizetype index = findGlyph(str, &pos);
+        if (index < 0)
+            continue;
+        const QSvgGlyph &glyph = m_glyphs.at(index);
+        const QPainterPath glyphPath = glyph.m_path.translated(x, 0);
+        run.path.addPath(glyphPath);
+        run.glyphs.append({ index, x });
+
+        const QRectF glyphBounds = glyphPath.controlPointRect();
+        if (run.batches.isEmpty() || glyphBounds.intersects(batchBounds)) {
+            run.batches.append(QPainterPath());
+            run.batches.last().setFillRule(Qt::WindingFill);
+            batchBounds = QRectF();
+        }
+        run.batches.last().addPath(glyphPath);
+        batchBounds |= glyphBounds;
+
+        run.width += static_cast<int>(glyph.m_horizAdvX);
+        x += glyph.m_horizAdvX;
+    }
+
+    // Without overlaps, the whole path is the only batch
+    if (run.batches.size() == 1)
+        run.batches.clear();
+
+    const int cost = run.batches.isEmpty() ? run.path.elementCount() : 2 * run.path.elementCount();
+    m_textRuns.insert(str, new TextRun(run), qMax(1, cost));
+    return run;
 }
 
 
@@ -54,29 +153,17 @@ void QSvgFont::draw_helper(QPainter *p, const QPointF &point, const QString &str
                            Qt::Alignment alignment, QRectF *boundingRect) const
 {
     const bool isPainting = (boundingRect == nullptr);
+    const TextRun run = textRun(str);
 
     p->save();
     p->translate(point);
     p->scale(pixelSize / m_unitsPerEm, -pixelSize / m_unitsPerEm);
 
-    // Calculate the text width to be used for alignment
-    int textWidth = 0;
-    QString::const_iterator itr = str.constBegin();
-    for ( ; itr != str.constEnd(); ++itr) {
-        QChar unicode = *itr;
-        if (!m_glyphs.contains(*itr)) {
-            unicode = u'\0';
-            if (!m_glyphs.contains(unicode))
-                continue;
-        }
-        textWidth += static_cast<int>(m_glyphs[unicode].m_horizAdvX);
-    }
-
     QPoint alignmentOffset(0, 0);
     if (alignment == Qt::AlignHCenter) {
-        alignmentOffset.setX(-textWidth / 2);
+        alignmentOffset.setX(-run.width / 2);
     } else if (alignment == Qt::AlignRight) {
-        alignmentOffset.setX(-textWidth);
+        alignmentOffset.setX(-run.width);
     }
 
     p->translate(alignmentOffset);
@@ -89,28 +176,33 @@ void QSvgFont::draw_helper(QPainter *p, const QPointF &point, const QString &str
     pen.setWidthF(penWidth);
     p->setPen(pen);
 
-    itr = str.constBegin();
-    for ( ; itr != str.constEnd(); ++itr) {
-        QChar unicode = *itr;
-        if (!m_glyphs.contains(*itr)) {
-            unicode = u'\0';
-            if (!m_glyphs.contains(unicode))
-                continue;
-        }
-
-        if (isPainting)
-            p->drawPath(m_glyphs[unicode].m_path);
-
-        if (boundingRect) {
-            QPainterPathStroker stroker;
-            stroker.setWidth(penWidth);
-            stroker.setJoinStyle(p->pen().joinStyle());
-            stroker.setMiterLimit(p->pen().miterLimit());
-            QPainterPath stroke = stroker.createStroke(m_glyphs[unicode].m_path);
-            *boundingRect |= p->transform().map(stroke).boundingRect();
+    if (isPainting) {
+        // Overlapping glyphs filled as one path would not be blended twice where they
+        // overlap. Only opaque fills look the same. Strokes reach beyond the glyph
+        // bounds the batches are based on, and each glyph covers the strokes of the
+        // previous ones, so stroked text is drawn glyph by glyph.
+        const bool opaqueFill = p->brush().isOpaque() && p->opacity() == 1;
+        if (pen.style() != Qt::NoPen) {
+            for (const TextRun::Glyph &glyph : run.glyphs) {
+                p->translate(glyph.x, 0);
+                p->drawPath(m_glyphs.at(glyph.index).m_path);
+                p->translate(-glyph.x, 0);
+            }
+        } else if (opaqueFill || run.batches.isEmpty()) {
+            p->drawPath(run.path);
+        } else {
+            for (const QPainterPath &batch : run.batches)
+                p->drawPath(batch);
         }
+    }
 
-        p->translate(m_glyphs[unicode].m_horizAdvX, 0);
+    if (boundingRect && !run.path.isEmpty()) {
+        QPainterPathStroker stroker;
+        stroker.setWidth(penWidth);
+        stroker.setJoinStyle(p->pen().joinStyle());
+        stroker.setMiterLimit(p->pen().miterLimit());
+        QPainterPath stroke = stroker.createStroke(run.path);
+        *boundingRect |= p->transform().map(stroke).boundingRect();
     }
 
     p->restore();
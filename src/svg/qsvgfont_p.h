@@ -17,6 +17,8 @@
 
 #include "qpainterpath.h"
 #include "qhash.h"
+#include "qcache.h"
+#include "qlist.h"
 #include "qstring.h"
 #include "qsvgstyle_p.h"
 #include "qtsvgglobal_p.h"
@@ -26,10 +28,10 @@ QT_BEGIN_NAMESPACE
 class Q_SVG_EXPORT QSvgGlyph
 {
 public:
-    QSvgGlyph(QChar unicode, const QPainterPath &path, qreal horizAdvX);
-    QSvgGlyph() : m_unicode(0), m_horizAdvX(0) {}
+    QSvgGlyph(const QString &unicode, const QPainterPath &path, qreal horizAdvX);
+    QSvgGlyph() : m_horizAdvX(0) {}
 
-    QChar m_unicode;
+    QString m_unicode;
     QPainterPath m_path;
     qreal m_horizAdvX;
 };
@@ -46,7 +48,8 @@ public:
 
     void setUnitsPerEm(qreal upem);
 
-    void addGlyph(QChar unicode, const QPainterPath &path, qreal horizAdvX = -1);
+    void addGlyph(const QString &unicode, const QPainterPath &path, qreal horizAdvX = -1);
+    qsizetype findGlyph(QStringView str, qsizetype *pos) const;
 
     void draw(QPainter *p, const QPointF &point, const QString &str,
               qreal pixelSize, Qt::Alignment alignment) const;
@@ -57,11 +60,34 @@ public:
     QString m_familyName;
     qreal m_unitsPerEm = DEFAULT_UNITS_PER_EM;
     qreal m_horizAdvX;
-    QHash<QChar, QSvgGlyph> m_glyphs;
+
+    // All glyphs, indexed by the first code point of their unicode string. Candidates
+    // sharing a first code point are ordered by decreasing length, so that ligatures
+    // take precedence. The missing glyph has an empty unicode string.
+    QList<QSvgGlyph> m_glyphs;
+    QHash<char32_t, QList<qsizetype>> m_glyphIndex;
+    qsizetype m_missingGlyph = -1;
 
 private:
+    // The glyphs of a string combined into one path, in font units. If glyphs overlap,
+    // batches split the path into runs of glyphs whose bounding boxes do not intersect.
+    // glyphs holds the index and offset of each glyph, for drawing them one by one.
+    struct TextRun {
+        struct Glyph {
+            qsizetype index;
+            qreal x;
+        };
+        QPainterPath path;
+        QList<QPainterPath> batches;
+        QList<Glyph> glyphs;
+        int width = 0;
+    };
+
+    TextRun textRun(const QString &str) const;
     void draw_helper(QPainter *p, const QPointF &point, const QString &str, qreal pixelSize,
                      Qt::Alignment alignment, QRectF *boundingRect = nullptr) const;
+
+    mutable QCache<QString, TextRun> m_textRuns;
 };
 
 QT_END_NAMESPACE
@@ -4,20 +4,31 @@
 #include "qsvggraphics_p.h"
 #include "qsvgstructure_p.h"
 #include "qsvgfont_p.h"
+#include "qsvgtinydocument_p.h"
 
 #include <qabstracttextdocumentlayout.h>
+#include <qbuffer.h>
 #include <qdebug.h>
+#include <qfontmetrics.h>
+#include <qimageiohandler.h>
+#include <qimagereader.h>
+#include <qpaintengine.h>
 #include <qloggingcategory.h>
+#include <qmath.h>
 #include <qpainter.h>
+#include <qglyphrun.h>
+#include <qrawfont.h>
 #include <qscopedvaluerollback.h>
 #include <qtextcursor.h>
 #include <qtextdocument.h>
+#include <qvarlengtharray.h>
 #include <private/qfixed_p.h>
 
 #include <QElapsedTimer>
 #include <QLoggingCategory>
 
 #include <math.h>
+#include <algorithm>
 #include <limits.h>
 
 QT_BEGIN_NAMESPACE
@@ -73,23 +84,144 @@ bool QSvgEllipse::separateFillStroke() const
 }
 
 QSvgImage::QSvgImage(QSvgNode *parent,
-                     const QImage &image,
+                     const QByteArray &data,
                      const QString &filename,
+                     const QByteArray &format,
                      const QRectF &bounds)
     : QSvgNode(parent)
     , m_filename(filename)
-    , m_image(image)
+    , m_data(data)
+    , m_format(format)
     , m_bounds(bounds)
 {
+    // Only the header is read here, the pixels are decoded when the image is drawn
+    QBuffer buffer;
+    QImageReader reader;
+    if (setupReader(&reader, &buffer)) {
+        m_imageSize = reader.size();
+        m_scalable = m_imageSize.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize);
+    }
+
     if (m_bounds.width() == 0.0)
-        m_bounds.setWidth(static_cast<qreal>(m_image.width()));
+        m_bounds.setWidth(static_cast<qreal>(m_imageSize.width()));
     if (m_bounds.height() == 0.0)
-        m_bounds.setHeight(static_cast<qreal>(m_image.height()));
+        m_bounds.setHeight(static_cast<qreal>(m_imageSize.height()));
+}
+
+// The reader is restricted to the format detected when the document was parsed, so
+// a file replaced since then cannot be decoded as another format. SVG images are only
+// read from trusted sources. Returns false if the image must not be read.
+bool QSvgImage::setupReader(QImageReader *reader, QBuffer *buffer) const
+{
+    const QSvgTinyDocument *doc = document();
+    if (m_format.isEmpty() || (m_format.startsWith("svg")
+                               && !(doc && doc->options().testFlag(QtSvg::AssumeTrustedSource)))) {
+        return false;
+    }
+
+    if (m_data.isEmpty()) {
+        reader->setFileName(m_filename);
+    } else {
+        buffer->setData(m_data);
+        reader->setDevice(buffer);
+    }
+    reader->setFormat(m_format);
+    reader->setAutoDetectImageFormat(false);
+    return true;
+}
+
+// Returns the image decoded at targetSize, or at its full size if targetSize is
+// invalid or the format cannot be decoded scaled. Decoded images are kept in a cache
+// of the document, which drops them when it runs out of budget.
+QImage QSvgImage::image(QSize targetSize) const
+{
+    QSize decodeSize = m_imageSize;
+    if (m_scalable && !targetSize.isEmpty())
+        decodeSize = targetSize.boundedTo(m_imageSize);
+
+    QSvgTinyDocument *doc = document();
+    if (const QImage *cached = doc ? doc->decodedImage(this) : nullptr) {
+        // A decoding up to twice as large as needed is good enough
+        const QSize size = cached->size();
+        if (!m_scalable || size == decodeSize
+            || (size.width() >= decodeSize.width() && size.height() >= decodeSize.height()
+                && size.width() <= 2 * decodeSize.width() && size.height() <= 2 * decodeSize.height())) {
+            return *cached;
+        }
+    }
+    if (m_decodeFailed)
+        return QImage();
+
+    QBuffer buffer;
+    QImageReader reader;
+    if (!setupReader(&reader, &buffer)) {
+        m_decodeFailed = true;
+        return QImage();
+    }
+    if (decodeSize != m_imageSize)
+        reader.setScaledSize(decodeSize);
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qCWarning(lcSvgDraw) << "Could not decode image" << m_filename << reader.errorString();
+        m_decodeFailed = true;
+        return QImage();
+    }
+    if (image.format() == QImage::Format_ARGB32)
+        image.convertTo(QImage::Format_ARGB32_Premultiplied);
+
+    if (doc)
+        doc->cacheDecodedImage(this, image);
+    return image;
 }
 
 void QSvgImage::drawCommand(QPainter *p, QSvgExtraStates &)
 {
-    p->drawImage(m_bounds, m_image);
+    const bool isRaster = p->paintEngine() && p->paintEngine()->type() == QPaintEngine::Raster;
+    const QTransform xf = p->deviceTransform();
+    const QRectF deviceRect = xf.mapRect(m_bounds);
+
+    // On the raster engine, decode no more pixels than the image covers on the device
+    QSize targetSize;
+    if (isRaster && m_scalable) {
+        targetSize = QSize(qMax(1, qCeil(qMin(deviceRect.width(), qreal(m_imageSize.width())))),
+                           qMax(1, qCeil(qMin(deviceRect.height(), qreal(m_imageSize.height())))));
+    }
+
+    const QImage img = image(targetSize);
+    if (img.isNull())
+        return;
+
+    // A downscaled image is resampled once for the device pixels it covers, honoring
+    // image-rendering through the SmoothPixmapTransform hint. The target is snapped to
+    // device pixels, so painting it is a blit rather than a second filtered draw.
+    QSvgTinyDocument *doc = document();
+    if (doc && isRaster && xf.type() <= QTransform::TxScale && xf.m11() > 0 && xf.m22() > 0
+        && deviceRect.width() < img.width() + 0.5 && deviceRect.height() < img.height() + 0.5) {
+        const QPoint topLeft(qRound(deviceRect.left()), qRound(deviceRect.top()));
+        const QSize displaySize(qRound(deviceRect.right()) - topLeft.x(),
+                                qRound(deviceRect.bottom()) - topLeft.y());
+        if (!displaySize.isEmpty() && displaySize != img.size()) {
+            const bool smooth = p->testRenderHint(QPainter::SmoothPixmapTransform);
+            const qreal dpr = p->device()->devicePixelRatio();
+            QImage displayImage;
+            if (const QImage *cached = doc->displayImage(this, displaySize, smooth))
+                displayImage = *cached;
+            if (displayImage.isNull() || displayImage.devicePixelRatio() != dpr) {
+                displayImage = img.scaled(displaySize, Qt::IgnoreAspectRatio,
+                                          smooth ? Qt::SmoothTransformation : Qt::FastTransformation);
+                displayImage.setDevicePixelRatio(dpr);
+                doc->cacheDisplayImage(this, displaySize, smooth, displayImage);
+            }
+
+            p->save();
+            p->resetTransform();
+            p->drawImage(QPointF(topLeft) / dpr, displayImage);
+            p->restore();
+            return;
+        }
+    }
+
+    p->drawImage(m_bounds, img);
 }
 
 QSvgLine::QSvgLine(QSvgNode *parent, const QLineF &line)
@@ -270,6 +402,101 @@ bool QSvgRect::separateFillStroke() const
 
 QSvgTspan * const QSvgText::LINEBREAK = 0;
 
+// The laid out paragraphs of a text node, with the text, formats and anchor they were
+// laid out from. As long as those do not change, painting and bounds queries reuse them.
+struct QSvgText::LayoutCache
+{
+    LayoutCache() = default;
+    ~LayoutCache() { qDeleteAll(layouts); }
+    Q_DISABLE_COPY_MOVE(LayoutCache)
+
+    void buildPaths(qreal positionY);
+
+    QList<QString> paragraphs;
+    QList<QList<QTextLayout::FormatRange>> formatRanges;
+    Qt::Alignment alignment;
+
+    // Only the paragraphs that fit into the text area, each with its clip
+    QList<QTextLayout *> layouts;
+    QList<QRectF> clips;
+    QRectF boundingRect;
+    QRectF bounds;
+
+    // The glyphs and decorations of each format range as geometry, with QtSvg::TextAsPaths
+    struct TextPath {
+        QPainterPath path;
+        QBrush brush;
+        QPen pen;
+    };
+    QList<TextPath> paths;
+    bool pathsBuilt = false;
+};
+
+// Converts the glyphs and decorations drawn by the layouts into paths, skipping the
+// lines that QTextLayout::draw() would skip for the clip of their paragraph
+void QSvgText::LayoutCache::buildPaths(qreal positionY)
+{
+    pathsBuilt = true;
+    for (qsizetype i = 0; i < layouts.size(); ++i) {
+        const QTextLayout *tl = layouts.at(i);
+        const QRectF &clip = clips.at(i);
+        for (const QTextLayout::FormatRange &range : formatRanges.at(i)) {
+            TextPath textPath;
+            textPath.path.setFillRule(Qt::WindingFill);
+            textPath.brush = range.format.foreground();
+            textPath.pen = range.format.textOutline();
+
+            // Decorations become rectangles at the offsets from the baseline that the
+            // font engine would draw them at
+            const QFont rangeFont = range.format.font();
+            const QFontMetricsF metrics(rangeFont);
+            const qreal lineWidth = metrics.lineWidth();
+            QVarLengthArray<qreal, 3> decorations;
+            if (rangeFont.underline())
+                decorations.append(metrics.underlinePos());
+            if (rangeFont.overline())
+                decorations.append(-metrics.overlinePos());
+            if (rangeFont.strikeOut())
+                decorations.append(-metrics.strikeOutPos());
+
+            for (int j = 0; j < tl->lineCount(); ++j) {
+                const QTextLine line = tl->lineAt(j);
+                if (clip.isValid() && (line.y() > clip.bottom() - positionY
+                                       || line.y() + line.height() < clip.top() - positionY)) {
+                    continue;
+                }
+                const int from = qMax(range.start, line.textStart());
+                const int to = qMin(range.start + range.length, line.textStart() + line.textLength());
+                if (to <= from)
+                    continue;
+
+                const QList<QGlyphRun> runs = line.glyphRuns(from, to - from);
+                for (const QGlyphRun &run : runs) {
+                    const QRawFont font = run.rawFont();
+                    const QList<quint32> indexes = run.glyphIndexes();
+                    const QList<QPointF> positions = run.positions();
+                    for (qsizetype k = 0; k < indexes.size(); ++k)
+                        textPath.path.addPath(font.pathForGlyph(indexes.at(k)).translated(positions.at(k)));
+                }
+
+                if (!decorations.isEmpty()) {
+                    const qreal x1 = line.cursorToX(from);
+                    const qreal x2 = line.cursorToX(to);
+                    const qreal left = qMin(x1, x2);
+                    const qreal width = qAbs(x2 - x1);
+                    const qreal baseline = line.y() + line.ascent();
+                    for (qreal offset : std::as_const(decorations)) {
+                        textPath.path.addRect(QRectF(left, baseline + offset - lineWidth / 2,
+                                                     width, lineWidth));
+                    }
+                }
+            }
+            if (!textPath.path.isEmpty())
+                paths.append(textPath);
+        }
+    }
+}
+
 QSvgText::QSvgText(QSvgNode *parent, const QPointF &coord)
     : QSvgNode(parent)
     , m_coord(coord)
@@ -366,8 +593,6 @@ void QSvgText::draw_helper(QPainter *p, QSvgExtraStates &states, QRectF *boundin
         QFont font = p->font();
         Qt::Alignment alignment = states.textAnchor;
 
-        qreal y = 0;
-        bool initial = true;
         qreal px = m_coord.x();
         qreal py = m_coord.y();
 
@@ -378,10 +603,6 @@ void QSvgText::draw_helper(QPainter *p, QSvgExtraStates &states, QRectF *boundin
                 px += m_size.width();
         }
 
-        QRectF bounds;
-        if (m_size.height() != 0)
-            bounds = QRectF(0, py, 1, m_size.height()); // x and width are not used.
-
         bool appendSpace = false;
         QList<QString> paragraphs;
         QList<QList<QTextLayout::FormatRange> > formatRanges(1);
@@ -469,63 +690,30 @@ void QSvgText::draw_helper(QPainter *p, QSvgExtraStates &states, QRectF *boundin
                         p, m_coord, text, p->font().pointSizeF(), states.textAnchor);
             }
         } else {
-            QRectF brect;
-            for (int i = 0; i < paragraphs.size(); ++i) {
-                QTextLayout tl(paragraphs[i]);
-                QTextOption op = tl.textOption();
-                op.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
-                tl.setTextOption(op);
-                tl.setFormats(formatRanges[i]);
-                tl.beginLayout();
-
-                forever {
-                    QTextLine line = tl.createLine();
-                    if (!line.isValid())
-                        break;
-                    if (m_size.width() != 0)
-                        line.setLineWidth(m_size.width());
+            LayoutCache &cache = layout(paragraphs, formatRanges, alignment);
+            const QSvgTinyDocument *doc = document();
+            if (isPainting && doc && doc->options().testFlag(QtSvg::TextAsPaths)) {
+                if (!cache.pathsBuilt)
+                    cache.buildPaths(py);
+                const QTransform oldTransform = p->transform();
+                p->translate(px, py);
+                for (const LayoutCache::TextPath &textPath : std::as_const(cache.paths)) {
+                    if (textPath.brush.style() != Qt::NoBrush)
+                        p->fillPath(textPath.path, textPath.brush);
+                    if (textPath.pen.style() != Qt::NoPen)
+                        p->strokePath(textPath.path, textPath.pen);
                 }
-                tl.endLayout();
-
-                bool endOfBoundsReached = false;
-                for (int i = 0; i < tl.lineCount(); ++i) {
-                    QTextLine line = tl.lineAt(i);
-
-                    qreal x = 0;
-                    if (alignment == Qt::AlignHCenter)
-                        x -= 0.5 * line.naturalTextWidth();
-                    else if (alignment == Qt::AlignRight)
-                        x -= line.naturalTextWidth();
-
-                    if (initial && m_type == Text)
-                        y -= line.ascent();
-                    initial = false;
-
-                    line.setPosition(QPointF(x, y));
-                    brect |= line.naturalTextRect();
-
-                    // Check if the current line fits into the bounding rectangle.
-                    if ((m_size.width() != 0 && line.naturalTextWidth() > m_size.width())
-                        || (m_size.height() != 0 && y + line.height() > m_size.height())) {
-                        // I need to set the bounds height to 'y-epsilon' to avoid drawing the current
-                        // line. Since the font is scaled to 100 units, 1 should be a safe epsilon.
-                        bounds.setHeight(y - 1);
-                        endOfBoundsReached = true;
-                        break;
-                    }
-
-                    y += 1.1 * line.height();
+                p->setTransform(oldTransform);
+            } else if (isPainting) {
+                for (qsizetype i = 0; i < cache.layouts.size(); ++i) {
+                    cache.layouts.at(i)->draw(p, QPointF(px, py), QList<QTextLayout::FormatRange>(),
+                                              cache.clips.at(i));
                 }
-                if (isPainting)
-                    tl.draw(p, QPointF(px, py), QList<QTextLayout::FormatRange>(), bounds);
-
-                if (endOfBoundsReached)
-                    break;
             }
             if (boundingRect) {
-                brect.translate(m_coord);
-                if (bounds.height() > 0)
-                    brect.setBottom(qMin(brect.bottom(), bounds.bottom()));
+                QRectF brect = cache.boundingRect.translated(m_coord);
+                if (cache.bounds.height() > 0)
+                    brect.setBottom(qMin(brect.bottom(), cache.bounds.bottom()));
                 *boundingRect = brect;
             }
         }
@@ -534,6 +722,86 @@ void QSvgText::draw_helper(QPainter *p, QSvgExtraStates &states, QRectF *boundin
     }
 }
 
+QSvgText::LayoutCache &QSvgText::layout(const QList<QString> &paragraphs,
+                                        const QList<QList<QTextLayout::FormatRange>> &formatRanges,
+                                        Qt::Alignment alignment) const
+{
+    if (m_layoutCache && m_layoutCache->alignment == alignment
+        && m_layoutCache->paragraphs == paragraphs && m_layoutCache->formatRanges == formatRanges) {
+        return *m_layoutCache;
+    }
+
+    m_layoutCache.reset(new LayoutCache);
+    LayoutCache &cache = *m_layoutCache;
+    cache.paragraphs = paragraphs;
+    cache.formatRanges = formatRanges;
+    cache.alignment = alignment;
+
+    qreal y = 0;
+    bool initial = true;
+
+    QRectF bounds;
+    if (m_size.height() != 0)
+        bounds = QRectF(0, m_coord.y(), 1, m_size.height()); // x and width are not used.
+
+    QRectF brect;
+    for (int i = 0; i < paragraphs.size(); ++i) {
+        QTextLayout *tl = new QTextLayout(paragraphs[i]);
+        QTextOption op = tl->textOption();
+        op.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+        tl->setTextOption(op);
+        tl->setFormats(formatRanges[i]);
+        tl->beginLayout();
+
+        forever {
+            QTextLine line = tl->createLine();
+            if (!line.isValid())
+                break;
+            if (m_size.width() != 0)
+                line.setLineWidth(m_size.width());
+        }
+        tl->endLayout();
+
+        bool endOfBoundsReached = false;
+        for (int i = 0; i < tl->lineCount(); ++i) {
+            QTextLine line = tl->lineAt(i);
+
+            qreal x = 0;
+            if (alignment == Qt::AlignHCenter)
+                x -= 0.5 * line.naturalTextWidth();
+            else if (alignment == Qt::AlignRight)
+                x -= line.naturalTextWidth();
+
+            if (initial && m_type == Text)
+                y -= line.ascent();
+            initial = false;
+
+            line.setPosition(QPointF(x, y));
+            brect |= line.naturalTextRect();
+
+            // Check if the current line fits into the bounding rectangle.
+            if ((m_size.width() != 0 && line.naturalTextWidth() > m_size.width())
+                || (m_size.height() != 0 && y + line.height() > m_size.height())) {
+                // I need to set the bounds height to 'y-epsilon' to avoid drawing the current
+                // line. Since the font is scaled to 100 units, 1 should be a safe epsilon.
+                bounds.setHeight(y - 1);
+                endOfBoundsReached = true;
+                break;
+            }
+
+            y += 1.1 * line.height();
+        }
+        cache.layouts.append(tl);
+        cache.clips.append(bounds);
+
+        if (endOfBoundsReached)
+            break;
+    }
+    cache.boundingRect = brect;
+    cache.bounds = bounds;
+    return cache;
+}
+
 void QSvgText::addText(const QString &text)
 {
     m_tspans.append(new QSvgTspan(this, false));
@@ -568,7 +836,8 @@ void QSvgUse::drawCommand(QPainter *p, QSvgExtraStates &states)
     {
         QScopedValueRollback<int> useLevelGuard(states.nestedUseLevel, states.nestedUseLevel + 1);
         QScopedValueRollback<bool> recursingGuard(m_recursing, true);
-        m_link->draw(p, states);
+        if (!drawSprite(p, states))
+            m_link->draw(p, states);
     }
     if (states.nestedUseLevel == 0)
         states.nestedUseCount = 0;
@@ -578,6 +847,104 @@ void QSvgUse::drawCommand(QPainter *p, QSvgExtraStates &states)
     }
 }
 
+// With image-rendering="optimizeSpeed", content instantiated repeatedly at the same
+// scale and with the same inherited state is rendered once into a sprite. Further
+// instances blit the sprite, with their position rounded to a quarter device pixel.
+// Returns false if the content needs to be drawn directly.
+bool QSvgUse::drawSprite(QPainter *p, QSvgExtraStates &states)
+{
+    QSvgTinyDocument *doc = document();
+    if (!doc || states.imageRendering != QSvgQualityStyle::ImageRenderingOptimizeSpeed)
+        return false;
+
+    const QPaintDevice *device = p->device();
+    const bool hasViewTransform = p->viewTransformEnabled() && p->window() != p->viewport();
+    if (!device || !p->paintEngine() || p->paintEngine()->type() != QPaintEngine::Raster
+        || device->devicePixelRatio() != 1 || hasViewTransform
+        || p->compositionMode() != QPainter::CompositionMode_SourceOver) {
+        return false;
+    }
+
+    const QTransform xf = p->transform();
+    if (xf.isProjective() || !(qAbs(xf.dx()) < 1e7) || !(qAbs(xf.dy()) < 1e7))
+        return false;
+    const int quarterX = qRound(xf.dx() * 4);
+    const int quarterY = qRound(xf.dy() * 4);
+
+    // Changes to the link itself or to content referenced through <use> cannot be tracked
+    const QSharedPointer<QSvgAnimator> animator = doc->animated() ? doc->animator() : nullptr;
+    if (animator && (!animator->animationsForNode(m_link).isEmpty()
+                     || QSvgStructureNode::containsUse(m_link))) {
+        return false;
+    }
+    const quint64 frame = animator ? animator->frame() : 0;
+
+    const QPoint phase(quarterX & 3, quarterY & 3);
+    const QPoint position((quarterX - phase.x()) / 4, (quarterY - phase.y()) / 4);
+    const QSvgSpriteKey key{ m_link, xf.m11(), xf.m12(), xf.m21(), xf.m22(), phase,
+                             QSvgSprite::contextHash(p, states) };
+
+    const QSvgSprite *sprite = doc->sprite(key);
+    if (!sprite || !sprite->matches(p, states)) {
+        // Content that is only used once does not get a sprite, so the first instance
+        // is drawn directly
+        doc->cacheSprite(key, QSvgSprite::create(QImage(), p, states, frame, false));
+        return false;
+    }
+    if (sprite->tooLarge)
+        return false;
+
+    QImage image = sprite->image;
+    if (image.isNull() || (animator && animator->subtreeChangedSince(m_link, sprite->frame))) {
+        const QTransform linear(xf.m11(), xf.m12(), xf.m21(), xf.m22(), 0, 0);
+        image = renderSprite(p, states, linear * QTransform::fromTranslate(phase.x() / 4.0, phase.y() / 4.0));
+        // Drawing the content may have added sprites for other links and evicted this
+        // one, so the entry is replaced rather than updated
+        doc->cacheSprite(key, QSvgSprite::create(image, p, states, frame, image.isNull()));
+        if (image.isNull())
+            return false;
+    }
+
+    const qreal opacity = p->opacity();
+    p->resetTransform();
+    p->setOpacity(1);
+    p->drawImage(position + image.offset(), image);
+    p->setOpacity(opacity);
+    p->setTransform(xf);
+    return true;
+}
+
+QImage QSvgUse::renderSprite(QPainter *p, QSvgExtraStates &states, const QTransform &transform)
+{
+    constexpr int maxSpriteSize = 512;
+
+    const QTransform xf = p->transform();
+    p->setTransform(transform);
+    const QRect rect = m_link->decoratedBounds(p, states).toAlignedRect().adjusted(-1, -1, 1, 1);
+    p->setTransform(xf);
+    if (rect.isEmpty() || rect.width() > maxSpriteSize || rect.height() > maxSpriteSize)
+        return QImage();
+
+    QImage sprite;
+    if (!QImageIOHandler::allocateImage(rect.size(), QImage::Format_ARGB32_Premultiplied, &sprite))
+        return QImage();
+    sprite.fill(Qt::transparent);
+    sprite.setOffset(rect.topLeft());
+    sprite.setDotsPerMeterX(qRound(p->device()->logicalDpiX() / 0.0254));
+    sprite.setDotsPerMeterY(qRound(p->device()->logicalDpiY() / 0.0254));
+
+    QPainter spritePainter(&sprite);
+    spritePainter.setPen(p->pen());
+    spritePainter.setBrush(p->brush());
+    spritePainter.setFont(p->font());
+    spritePainter.setOpacity(p->opacity());
+    spritePainter.setRenderHints(p->renderHints());
+    spritePainter.translate(-rect.topLeft());
+    spritePainter.setTransform(transform, true);
+    m_link->draw(&spritePainter, states);
+    return sprite;
+}
+
 QSvgNode::Type QSvgDummyNode::type() const
 {
     return FeUnsupported;
@@ -23,12 +23,15 @@
 #include "QtGui/qtextlayout.h"
 #include "QtGui/qtextoption.h"
 #include "QtCore/qloggingcategory.h"
+#include "QtCore/qscopedpointer.h"
 #include "QtCore/qstack.h"
 
 QT_BEGIN_NAMESPACE
 
 Q_DECLARE_LOGGING_CATEGORY(lcSvgDraw);
 
+class QBuffer;
+class QImageReader;
 class QTextCharFormat;
 
 class Q_SVG_EXPORT QSvgDummyNode : public QSvgNode
@@ -64,19 +67,27 @@ class Q_SVG_EXPORT QSvgImage : public QSvgNode
 {
 public:
     QSvgImage(QSvgNode *parent,
-              const QImage &image,
+              const QByteArray &data,
               const QString &filename,
+              const QByteArray &format,
               const QRectF &bounds);
     void drawCommand(QPainter *p, QSvgExtraStates &states) override;
     Type type() const override;
     QRectF internalBounds(QPainter *p, QSvgExtraStates &states) const override;
 
     QRectF rect() const { return m_bounds; }
-    const QImage &image() const { return m_image; }
+    QImage image(QSize targetSize = QSize()) const;
+    QSize imageSize() const { return m_imageSize; }
     QString filename() const { return m_filename; }
 private:
+    bool setupReader(QImageReader *reader, QBuffer *buffer) const;
+
     QString m_filename;
-    QImage m_image;
+    QByteArray m_data;
+    QByteArray m_format;
+    QSize m_imageSize;
+    bool m_scalable = false;
+    mutable bool m_decodeFailed = false;
     QRectF m_bounds;
 };
 
@@ -197,7 +208,12 @@ public:
     WhitespaceMode whitespaceMode() const { return m_mode; }
 
 private:
+    struct LayoutCache;
+
     void draw_helper(QPainter *p, QSvgExtraStates &states, QRectF *boundingRect = nullptr) const;
+    LayoutCache &layout(const QList<QString> &paragraphs,
+                        const QList<QList<QTextLayout::FormatRange>> &formatRanges,
+                        Qt::Alignment alignment) const;
 
     static QSvgTspan * const LINEBREAK;
 
@@ -210,6 +226,8 @@ private:
     Type m_type;
     QSizeF m_size;
     WhitespaceMode m_mode;
+
+    mutable QScopedPointer<LayoutCache> m_layoutCache;
 };
 
 class Q_SVG_EXPORT QSvgTspan : public QSvgNode
@@ -253,6 +271,9 @@ public:
     bool isRecursing() const { return m_recursing; }
 
 private:
+    bool drawSprite(QPainter *p, QSvgExtraStates &states);
+    QImage renderSprite(QPainter *p, QSvgExtraStates &states, const QTransform &transform);
+
     QSvgNode *m_link;
     QPointF   m_start;
     QString   m_linkId;
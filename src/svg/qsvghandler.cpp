@@ -21,6 +21,7 @@
 #include "qlist.h"
 #include "qfileinfo.h"
 #include "qfile.h"
+#include "qbuffer.h"
 #include "qdir.h"
 #include "qdebug.h"
 #include "qmath.h"
@@ -32,6 +33,7 @@
 #include "qimagereader.h"
 
 #include "float.h"
+#include <array>
 #include <cmath>
 
 QT_BEGIN_NAMESPACE
@@ -71,80 +73,52 @@ static inline QByteArray msgCouldNotResolveProperty(const QString &id, const QXm
     return prefixMessage(QByteArrayLiteral("Could not resolve property: ") + id.toLocal8Bit(), r);
 }
 
-// ======== duplicated from qcolor_p
-
-static inline int qsvg_h2i(char hex, bool *ok = nullptr)
-{
-    if (hex >= '0' && hex <= '9')
-        return hex - '0';
-    if (hex >= 'a' && hex <= 'f')
-        return hex - 'a' + 10;
-    if (hex >= 'A' && hex <= 'F')
-        return hex - 'A' + 10;
-    if (ok)
-        *ok = false;
-    return -1;
-}
-
-static inline int qsvg_hex2int(const char *s, bool *ok = nullptr)
-{
-    return (qsvg_h2i(s[0], ok) * 16) | qsvg_h2i(s[1], ok);
-}
-
-static inline int qsvg_hex2int(char s, bool *ok = nullptr)
-{
-    int h = qsvg_h2i(s, ok);
-    return (h * 16) | h;
-}
+// Values of hex digits, 0xff for all other Latin-1 characters
+static constexpr auto qsvg_hexDigits = [] {
+    std::array<quint8, 256> table = {};
+    for (int i = 0; i < 256; ++i)
+        table[i] = 0xff;
+    for (int i = 0; i < 10; ++i)
+        table['0' + i] = i;
+    for (int i = 0; i < 6; ++i) {
+        table['a' + i] = 10 + i;
+        table['A' + i] = 10 + i;
+    }
+    return table;
+}();
 
-bool qsvg_get_hex_rgb(const char *name, QRgb *rgb)
+// Parses #rgb, #rrggbb, #rrrgggbbb and #rrrrggggbbbb without copying the string.
+// The digits are decoded in one branch free pass and validated together.
+static bool qsvg_get_hex_rgb(QStringView str, QRgb *rgb)
 {
-    if(name[0] != '#')
+    if (str.isEmpty() || str.front() != QLatin1Char('#'))
         return false;
-    name++;
-    const size_t len = qstrlen(name);
-    int r, g, b;
-    bool ok = true;
-    if (len == 12) {
-        r = qsvg_hex2int(name, &ok);
-        g = qsvg_hex2int(name + 4, &ok);
-        b = qsvg_hex2int(name + 8, &ok);
-    } else if (len == 9) {
-        r = qsvg_hex2int(name, &ok);
-        g = qsvg_hex2int(name + 3, &ok);
-        b = qsvg_hex2int(name + 6, &ok);
-    } else if (len == 6) {
-        r = qsvg_hex2int(name, &ok);
-        g = qsvg_hex2int(name + 2, &ok);
-        b = qsvg_hex2int(name + 4, &ok);
-    } else if (len == 3) {
-        r = qsvg_hex2int(name[0], &ok);
-        g = qsvg_hex2int(name[1], &ok);
-        b = qsvg_hex2int(name[2], &ok);
-    } else {
-        r = g = b = -1;
+    str = str.sliced(1);
+    const qsizetype len = str.size();
+    if (len != 3 && len != 6 && len != 9 && len != 12)
+        return false;
+
+    quint8 digits[12];
+    quint8 invalid = 0;
+    for (qsizetype i = 0; i < len; ++i) {
+        const char16_t ch = str[i].unicode();
+        digits[i] = qsvg_hexDigits[ch & 0xff] | (ch > 0xff ? 0xff : 0);
+        invalid |= digits[i];
     }
-    if ((uint)r > 255 || (uint)g > 255 || (uint)b > 255 || !ok) {
-        *rgb = 0;
+    if (invalid & 0xf0)
         return false;
+
+    // Only the two most significant digits of each component are used
+    const qsizetype n = len / 3;
+    int components[3];
+    for (int c = 0; c < 3; ++c) {
+        const quint8 *d = digits + c * n;
+        components[c] = n == 1 ? d[0] * 17 : d[0] * 16 + d[1];
     }
-    *rgb = qRgb(r, g ,b);
+    *rgb = qRgb(components[0], components[1], components[2]);
     return true;
 }
 
-bool qsvg_get_hex_rgb(const QChar *str, int len, QRgb *rgb)
-{
-    if (len > 13)
-        return false;
-    char tmp[16];
-    for(int i = 0; i < len; ++i)
-        tmp[i] = str[i].toLatin1();
-    tmp[len] = 0;
-    return qsvg_get_hex_rgb(tmp, rgb);
-}
-
-// ======== end of qcolor_p duplicate
-
 static bool parsePathDataFast(QStringView data, QPainterPath &path, bool limitLength = true);
 
 static inline QString someId(const QXmlStreamAttributes &attributes)
@@ -165,6 +139,7 @@ struct QSvgAttributes
     QStringView colorOpacity;
     QStringView fill;
     QStringView fillRule;
+    QStringView clipRule;
     QStringView fillOpacity;
     QStringView stroke;
     QStringView strokeDashArray;
@@ -191,6 +166,7 @@ struct QSvgAttributes
     QStringView stopOpacity;
     QStringView imageRendering;
     QStringView mask;
+    QStringView clipPath;
     QStringView markerStart;
     QStringView markerMid;
     QStringView markerEnd;
@@ -247,6 +223,11 @@ QSvgAttributes::QSvgAttributes(const QXmlStreamAttributes &xmlAttributes, QSvgHa
                 colorOpacity = value;
             else if (name == QLatin1String("comp-op"))
                 compOp = value;
+            else if (name == QLatin1String("clip-path") &&
+                     !handler->options().testFlag(QtSvg::Tiny12FeaturesOnly))
+                clipPath = value;
+            else if (name == QLatin1String("clip-rule"))
+                clipRule = value;
             break;
 
         case 'd':
@@ -376,6 +357,11 @@ QSvgAttributes::QSvgAttributes(const QXmlStreamAttributes &xmlAttributes, QSvgHa
                     colorOpacity = value;
                 else if (name == QLatin1String("comp-op"))
                     compOp = value;
+                else if (name == QLatin1String("clip-path") &&
+                         !handler->options().testFlag(QtSvg::Tiny12FeaturesOnly))
+                    clipPath = value;
+                else if (name == QLatin1String("clip-rule"))
+                    clipRule = value;
                 break;
 
             case 'd':
@@ -494,6 +480,85 @@ public:
     {
     }
 
+    void addStyleSheet(const QString &css)
+    {
+        // Parsing indexes the rules whose subject has an id or element name. Rules
+        // whose subject has a class go into per class buckets, so each node is only
+        // matched against rules that can apply to it. The buckets keep the order
+        // the rules were given in, which breaks ties between equal specificities.
+        QCss::StyleSheet sheet;
+        QCss::Parser(css).parse(&sheet, nameCaseSensitivity);
+        QHash<QString, QCss::StyleSheet> classRules;
+        QList<QCss::StyleRule> otherRules;
+        for (const QCss::StyleRule &rule : std::as_const(sheet.styleRules)) {
+            QList<QCss::Selector> otherSelectors;
+            for (const QCss::Selector &selector : rule.selectors) {
+                const QString className = subjectClass(selector);
+                if (className.isEmpty()) {
+                    otherSelectors.append(selector);
+                    continue;
+                }
+                QCss::StyleRule classRule;
+                classRule.selectors.append(selector);
+                classRule.declarations = rule.declarations;
+                classRule.order = rule.order;
+                QCss::StyleSheet &bucket = classRules[className];
+                bucket.origin = sheet.origin;
+                bucket.depth = sheet.depth;
+                bucket.styleRules.append(classRule);
+            }
+            if (otherSelectors.size() == rule.selectors.size()) {
+                otherRules.append(rule);
+            } else if (!otherSelectors.isEmpty()) {
+                QCss::StyleRule otherRule = rule;
+                otherRule.selectors = otherSelectors;
+                otherRules.append(otherRule);
+            }
+        }
+        sheet.styleRules = otherRules;
+
+        styleSheets.append(sheet);
+        m_classRules.append(classRules);
+        m_hasClassRules = m_hasClassRules || !classRules.isEmpty();
+    }
+
+    bool hasRules() const
+    {
+        return !styleSheets.isEmpty();
+    }
+
+    QList<QCss::Declaration> declarationsForSvgNode(QSvgNode *node)
+    {
+        NodePtr cssNode;
+        cssNode.ptr = node;
+        const QString xmlClass = node->xmlClass();
+        if (!m_hasClassRules || xmlClass.isEmpty())
+            return declarationsForNode(cssNode);
+
+        // Match against each sheet followed by the buckets of the node's classes
+        const QList<QStringView> classNames = QStringView(xmlClass).split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        const QList<QCss::StyleSheet> sheets = styleSheets;
+        QList<QCss::StyleSheet> candidates;
+        for (qsizetype i = 0; i < sheets.size(); ++i) {
+            candidates.append(sheets.at(i));
+            const QHash<QString, QCss::StyleSheet> &classRules = m_classRules.at(i);
+            if (classRules.isEmpty())
+                continue;
+            for (qsizetype j = 0; j < classNames.size(); ++j) {
+                if (classNames.indexOf(classNames.at(j)) != j)
+                    continue;
+                const auto it = classRules.constFind(classNames.at(j).toString());
+                if (it != classRules.cend())
+                    candidates.append(*it);
+            }
+        }
+
+        styleSheets = candidates;
+        const QList<QCss::Declaration> declarations = declarationsForNode(cssNode);
+        styleSheets = sheets;
+        return declarations;
+    }
+
     inline QString nodeToName(QSvgNode *node) const
     {
         return node->typeName();
@@ -527,8 +592,7 @@ public:
         QSvgNode *n = svgNode(node);
         if (!n)
             return false;
-        QString name = nodeToName(n);
-        return QString::compare(name, nodeName, Qt::CaseInsensitive) == 0;
+        return nodeToName(n).compare(nodeName, Qt::CaseInsensitive) == 0;
     }
     QString attributeValue(NodePtr node, const QCss::AttributeSelector &asel) const override
     {
@@ -551,11 +615,9 @@ public:
     QStringList nodeIds(NodePtr node) const override
     {
         QSvgNode *n = svgNode(node);
-        QString nid;
-        if (n)
-            nid = n->nodeId();
-        QStringList lst; lst.append(nid);
-        return lst;
+        if (!n || n->nodeId().isEmpty())
+            return QStringList();
+        return QStringList(n->nodeId());
     }
 
     QStringList nodeNames(NodePtr node) const override
@@ -612,6 +674,23 @@ public:
     {
         Q_UNUSED(node);
     }
+
+private:
+    static QString subjectClass(const QCss::Selector &selector)
+    {
+        if (selector.basicSelectors.isEmpty())
+            return QString();
+        for (const QCss::AttributeSelector &attribute : selector.basicSelectors.constLast().attributeSelectors) {
+            if (attribute.valueMatchCriterium == QCss::AttributeSelector::MatchIncludes
+                && attribute.name == QLatin1String("class")) {
+                return attribute.value;
+            }
+        }
+        return QString();
+    }
+
+    QList<QHash<QString, QCss::StyleSheet>> m_classRules; // parallel to styleSheets
+    bool m_hasClassRules = false;
 };
 
 #endif // QT_NO_CSSPARSER
@@ -771,12 +850,8 @@ static inline void parseNumbersArray(const QChar *&str, QVarLengthArray<qreal, 8
     }
 }
 
-static QList<qreal> parsePercentageList(const QChar *&str)
+static inline void parsePercentageArray(const QChar *&str, QVarLengthArray<qreal, 8> &points)
 {
-    QList<qreal> points;
-    if (!str)
-        return points;
-
     while (str->isSpace())
         ++str;
     while ((*str >= QLatin1Char('0') && *str <= QLatin1Char('9')) ||
@@ -798,8 +873,6 @@ static QList<qreal> parsePercentageList(const QChar *&str)
         while (str->isSpace())
             ++str;
     }
-
-    return points;
 }
 
 static QString idFromUrl(const QString &url)
@@ -849,7 +922,7 @@ static bool resolveColor(QStringView colorStr, QColor &color, QSvgHandler *handl
                 // #rrggbb is very very common, so let's tackle it here
                 // rather than falling back to QColor
                 QRgb rgb;
-                bool ok = qsvg_get_hex_rgb(colorStrTr.constData(), colorStrTr.size(), &rgb);
+                bool ok = qsvg_get_hex_rgb(colorStrTr, &rgb);
                 if (ok)
                     color.setRgb(rgb);
                 return ok;
@@ -862,12 +935,14 @@ static bool resolveColor(QStringView colorStr, QColor &color, QSvgHandler *handl
                 if (colorStrTr.size() >= 7 && colorStrTr.at(colorStrTr.size() - 1) == QLatin1Char(')')
                     && colorStrTr.mid(0, 4) == QLatin1String("rgb(")) {
                     const QChar *s = colorStrTr.constData() + 4;
-                    QList<qreal> compo = parseNumbersList(s);
+                    QVarLengthArray<qreal, 8> compo;
+                    parseNumbersArray(s, compo);
                     //1 means that it failed after reaching non-parsable
                     //character which is going to be "%"
                     if (compo.size() == 1) {
                         s = colorStrTr.constData() + 4;
-                        compo = parsePercentageList(s);
+                        compo.clear();
+                        parsePercentageArray(s, compo);
                         for (int i = 0; i < compo.size(); ++i)
                             compo[i] *= (qreal)2.55;
                     }
@@ -897,7 +972,8 @@ static bool resolveColor(QStringView colorStr, QColor &color, QSvgHandler *handl
             break;
     }
 
-    color = QColor::fromString(colorStrTr.toString());
+    // Named colors are looked up in QColor's table of SVG color keywords
+    color = QColor::fromString(colorStrTr);
     return color.isValid();
 }
 
@@ -973,7 +1049,7 @@ static bool createSvgGlyph(QSvgFont *font, const QXmlStreamAttributes &attribute
     QStringView havStr = attributes.value(QLatin1String("horiz-adv-x"));
     QStringView pathStr = attributes.value(QLatin1String("d"));
 
-    QChar unicode = (uncStr.isEmpty()) ? u'\0' : uncStr.at(0);
+    const QString unicode = uncStr.toString();
     qreal havx = (havStr.isEmpty()) ? -1 : toDouble(havStr);
     QPainterPath path;
     path.setFillRule(Qt::WindingFill);
@@ -1032,18 +1108,58 @@ static QSvgStyleProperty *styleFromUrl(QSvgNode *node, const QString &url)
     return node ? node->styleProperty(idFromUrl(url)) : 0;
 }
 
+static bool isClipPathContent(const QSvgNode *node)
+{
+    for (; node; node = node->parent()) {
+        if (node->type() == QSvgNode::ClipPath)
+            return true;
+    }
+    return false;
+}
+
+// Paint referring to other elements may not be resolved yet, and currentColor
+// depends on where the element is, so properties using either are not shared.
+static bool isSharablePaint(QStringView paint)
+{
+    return !paint.contains(QLatin1String("url")) && !paint.contains(QLatin1String("currentColor"));
+}
+
+static QString sharedStyleKey(char type, std::initializer_list<QStringView> values)
+{
+    QString key(QChar::fromLatin1(type));
+    for (QStringView value : values) {
+        key += value;
+        key += QChar(0x1f); // unit separator
+    }
+    return key;
+}
+
 static void parseBrush(QSvgNode *node,
                        const QSvgAttributes &attributes,
                        QSvgHandler *handler)
 {
-    if (!attributes.fill.isEmpty() || !attributes.fillRule.isEmpty() || !attributes.fillOpacity.isEmpty()) {
+    // Clip path content is never filled, so clip-rule can take the place of fill-rule
+    const QStringView fillRule = (!attributes.clipRule.isEmpty() && isClipPathContent(node))
+            ? attributes.clipRule : attributes.fillRule;
+
+    if (!attributes.fill.isEmpty() || !fillRule.isEmpty() || !attributes.fillOpacity.isEmpty()) {
+        const bool sharable = isSharablePaint(attributes.fill);
+        QString key;
+        if (sharable) {
+            key = sharedStyleKey('f', { fillRule, attributes.fillOpacity, attributes.fill });
+            if (QSvgStyleProperty *shared = handler->sharedStyleProperty(key)) {
+                node->appendStyleProperty(shared, attributes.id);
+                return;
+            }
+        }
+
         QSvgFillStyle *prop = new QSvgFillStyle;
 
         //fill-rule attribute handling
-        if (!attributes.fillRule.isEmpty() && attributes.fillRule != QT_INHERIT) {
-            if (attributes.fillRule == QLatin1String("evenodd"))
+        if (!fillRule.isEmpty() && fillRule != QT_INHERIT) {
+            if (fillRule == QLatin1String("evenodd"))
                 prop->setFillRule(Qt::OddEvenFill);
-            else if (attributes.fillRule == QLatin1String("nonzero"))
+            else if (fillRule == QLatin1String("nonzero"))
                 prop->setFillRule(Qt::WindingFill);
         }
 
@@ -1074,18 +1190,82 @@ static void parseBrush(QSvgNode *node,
                 prop->setBrush(QBrush(Qt::NoBrush));
             }
         }
+        if (sharable)
+            handler->addSharedStyleProperty(key, prop, sizeof(QSvgFillStyle));
         node->appendStyleProperty(prop, attributes.id);
     }
 }
 
 
 
+namespace {
+// The 2x3 affine part of a QTransform, accumulated while parsing a transform list.
+// Each operation is applied before the ones already parsed, like QTransform's own
+// translate(), rotate(), scale() and shear().
+struct QSvgAffine
+{
+    qreal m11 = 1, m12 = 0, m21 = 0, m22 = 1, dx = 0, dy = 0;
+
+    void prepend(qreal a, qreal b, qreal c, qreal d, qreal e, qreal f)
+    {
+        const qreal n11 = a * m11 + b * m21;
+        const qreal n12 = a * m12 + b * m22;
+        const qreal n21 = c * m11 + d * m21;
+        const qreal n22 = c * m12 + d * m22;
+        dx += e * m11 + f * m21;
+        dy += e * m12 + f * m22;
+        m11 = n11;
+        m12 = n12;
+        m21 = n21;
+        m22 = n22;
+    }
+    void translate(qreal tx, qreal ty)
+    {
+        dx += tx * m11 + ty * m21;
+        dy += tx * m12 + ty * m22;
+    }
+    void scale(qreal sx, qreal sy)
+    {
+        m11 *= sx;
+        m12 *= sx;
+        m21 *= sy;
+        m22 *= sy;
+    }
+    void rotate(qreal degrees)
+    {
+        // Exact values for right angles, as in QTransform::rotate()
+        qreal sina = 0;
+        qreal cosa = 0;
+        if (degrees == 90. || degrees == -270.) {
+            sina = 1;
+        } else if (degrees == 270. || degrees == -90.) {
+            sina = -1;
+        } else if (degrees == 180.) {
+            cosa = -1;
+        } else {
+            const qreal radians = qDegreesToRadians(degrees);
+            sina = qSin(radians);
+            cosa = qCos(radians);
+        }
+        prepend(cosa, sina, -sina, cosa, 0, 0);
+    }
+    void shear(qreal sh, qreal sv)
+    {
+        prepend(1, sv, sh, 1, 0, 0);
+    }
+    QTransform toTransform() const
+    {
+        return QTransform(m11, m12, m21, m22, dx, dy);
+    }
+};
+} // unnamed namespace
+
 static QTransform parseTransformationMatrix(QStringView value)
 {
     if (value.isEmpty())
         return QTransform();
 
-    QTransform matrix;
+    QSvgAffine matrix;
     const QChar *str = value.constData();
     const QChar *end = str + value.size();
 
@@ -1168,9 +1348,9 @@ static QTransform parseTransformationMatrix(QStringView value)
         if(state == Matrix) {
             if(points.size() != 6)
                 goto error;
-            matrix = QTransform(points[0], points[1],
-                                points[2], points[3],
-                                points[4], points[5]) * matrix;
+            matrix.prepend(points[0], points[1],
+                           points[2], points[3],
+                           points[4], points[5]);
         } else if (state == Translate) {
             if (points.size() == 1)
                 matrix.translate(points[0], 0);
@@ -1207,7 +1387,7 @@ static QTransform parseTransformationMatrix(QStringView value)
         }
     }
   error:
-    return matrix;
+    return matrix.toTransform();
 }
 
 static void parsePen(QSvgNode *node,
@@ -1220,6 +1400,20 @@ static void parsePen(QSvgNode *node,
         || !attributes.strokeLineJoin.isEmpty() || !attributes.strokeMiterLimit.isEmpty() || !attributes.strokeOpacity.isEmpty() || !attributes.strokeWidth.isEmpty()
         || !attributes.vectorEffect.isEmpty()) {
 
+        const bool sharable = isSharablePaint(attributes.stroke);
+        QString key;
+        if (sharable) {
+            key = sharedStyleKey('s', { attributes.stroke, attributes.strokeDashArray,
+                                        attributes.strokeDashOffset, attributes.strokeLineCap,
+                                        attributes.strokeLineJoin, attributes.strokeMiterLimit,
+                                        attributes.strokeOpacity, attributes.strokeWidth,
+                                        attributes.vectorEffect });
+            if (QSvgStyleProperty *shared = handler->sharedStyleProperty(key)) {
+                node->appendStyleProperty(shared, attributes.id);
+                return;
+            }
+        }
+
         QSvgStrokeStyle *prop = new QSvgStrokeStyle;
 
         //stroke attribute handling
@@ -1320,6 +1514,8 @@ static void parsePen(QSvgNode *node,
         if (!attributes.strokeOpacity.isEmpty() && attributes.strokeOpacity != QT_INHERIT)
             prop->setOpacity(qMin(qreal(1.0), qMax(qreal(0.0), toDouble(attributes.strokeOpacity))));
 
+        if (sharable)
+            handler->addSharedStyleProperty(key, prop, sizeof(QSvgStrokeStyle));
         node->appendStyleProperty(prop, attributes.id);
     }
 }
@@ -1375,17 +1571,22 @@ static void parseFont(QSvgNode *node,
         attributes.fontWeight.isEmpty() && attributes.fontVariant.isEmpty() && attributes.textAnchor.isEmpty())
         return;
 
-    QSvgFontStyle *fontStyle = nullptr;
-    if (!attributes.fontFamily.isEmpty()) {
-        QSvgTinyDocument *doc = node->document();
-        if (doc) {
-            QSvgFont *svgFont = doc->svgFont(attributes.fontFamily.toString());
-            if (svgFont)
-                fontStyle = new QSvgFontStyle(svgFont, doc);
-        }
+    QSvgTinyDocument *doc = node->document();
+    QSvgFont *svgFont = nullptr;
+    if (!attributes.fontFamily.isEmpty() && doc)
+        svgFont = doc->svgFont(attributes.fontFamily.toString());
+
+    // An SVG font of the same family may be defined later in the document
+    const QString key = sharedStyleKey('t', { attributes.fontFamily, attributes.fontSize,
+                                              attributes.fontStyle, attributes.fontWeight,
+                                              attributes.fontVariant, attributes.textAnchor,
+                                              QString::number(quintptr(svgFont), 16) });
+    if (QSvgStyleProperty *shared = handler->sharedStyleProperty(key)) {
+        node->appendStyleProperty(shared, attributes.id);
+        return;
     }
-    if (!fontStyle)
-        fontStyle = new QSvgFontStyle;
+
+    QSvgFontStyle *fontStyle = svgFont ? new QSvgFontStyle(svgFont, doc) : new QSvgFontStyle;
     if (!attributes.fontFamily.isEmpty() && attributes.fontFamily != QT_INHERIT) {
         QString family = attributes.fontFamily.toString().trimmed();
         if (family.at(0) == QLatin1Char('\'') || family.at(0) == QLatin1Char('\"'))
@@ -1456,6 +1657,7 @@ static void parseFont(QSvgNode *node,
            fontStyle->setTextAnchor(Qt::AlignRight);
     }
 
+    handler->addSharedStyleProperty(key, fontStyle, sizeof(QSvgFontStyle));
     node->appendStyleProperty(fontStyle, attributes.id);
 }
 
@@ -1465,12 +1667,8 @@ static void parseTransform(QSvgNode *node,
 {
     if (attributes.transform.isEmpty())
         return;
-    QTransform matrix = parseTransformationMatrix(attributes.transform.trimmed());
-
-    if (!matrix.isIdentity()) {
-        node->appendStyleProperty(new QSvgTransformStyle(QTransform(matrix)), attributes.id);
-    }
-
+    const QTransform matrix = parseTransformationMatrix(attributes.transform.trimmed());
+    node->appendStyleProperty(new QSvgTransformStyle(matrix), attributes.id);
 }
 
 static void parseVisibility(QSvgNode *node,
@@ -2093,9 +2291,7 @@ static void cssStyleLookup(QSvgNode *node,
                            QSvgStyleSelector *selector,
                            QXmlStreamAttributes &attributes)
 {
-    QCss::StyleSelector::NodePtr cssNode;
-    cssNode.ptr = node;
-    QList<QCss::Declaration> decls = selector->declarationsForNode(cssNode);
+    QList<QCss::Declaration> decls = selector->declarationsForSvgNode(node);
 
     parseCSStoXMLAttrs(decls, attributes);
     parseStyle(node, attributes, handler);
@@ -2105,6 +2301,8 @@ static void cssStyleLookup(QSvgNode *node,
                            QSvgHandler *handler,
                            QSvgStyleSelector *selector)
 {
+    if (!selector->hasRules())
+        return;
     QXmlStreamAttributes attributes;
     cssStyleLookup(node, handler, selector, attributes);
 }
@@ -2121,6 +2319,21 @@ bool QSvgHandler::trustedSourceMode() const
     return m_options.testFlag(QtSvg::AssumeTrustedSource);
 }
 
+QSvgStyleProperty *QSvgHandler::sharedStyleProperty(const QString &key)
+{
+    const auto it = m_sharedStyles.constFind(key);
+    if (it == m_sharedStyles.cend())
+        return nullptr;
+    ++m_sharedStyleHits;
+    m_sharedStyleBytes += it->size;
+    return it->property;
+}
+
+void QSvgHandler::addSharedStyleProperty(const QString &key, QSvgStyleProperty *prop, qsizetype size)
+{
+    m_sharedStyles.insert(key, { prop, size });
+}
+
 static inline QStringList stringToList(const QString &str)
 {
     QStringList lst = str.split(QLatin1Char(','), Qt::SkipEmptyParts);
@@ -2341,6 +2554,17 @@ static void parseExtendedAttributes(QSvgNode *node,
         node->setMaskId(maskId);
     }
 
+    if (!attributes.clipPath.isEmpty()) {
+        QString clipPathStr = attributes.clipPath.toString().trimmed();
+        if (clipPathStr.size() > 3 && clipPathStr.mid(0, 3) == QLatin1String("url"))
+            clipPathStr = clipPathStr.mid(3, clipPathStr.size() - 3);
+        QString clipPathId = idFromUrl(clipPathStr);
+        if (clipPathId.startsWith(QLatin1Char('#'))) //TODO: handle urls and ids in a single place
+            clipPathId.remove(0, 1);
+
+        node->setClipPathId(clipPathId);
+    }
+
     if (!attributes.markerStart.isEmpty() &&
         !handler->options().testFlag(QtSvg::Tiny12FeaturesOnly)) {
         QString markerStr = attributes.markerStart.toString().trimmed();
@@ -2936,7 +3160,10 @@ static QSvgNode *createImageNode(QSvgNode *parent,
         return 0;
     }
 
-    QImage image;
+    // Only check that the image can be read, it is decoded when drawn. The detected
+    // format is kept, so a file replaced after this check is not read as another format.
+    QByteArray data;
+    QByteArray format;
     enum {
         NotLoaded,
         LoadedFromData,
@@ -2948,13 +3175,19 @@ static QSvgNode *createImageNode(QSvgNode *parent,
         if (idx != -1) {
             idx += 7;
             const QString dataStr = filename.mid(idx);
-            QByteArray data = QByteArray::fromBase64(dataStr.toLatin1());
-            image = QImage::fromData(data);
-            filenameType = LoadedFromData;
+            data = QByteArray::fromBase64(dataStr.toLatin1());
+            QBuffer buffer(&data);
+            QImageReader reader(&buffer);
+            if (reader.canRead()) {
+                format = reader.format();
+                filenameType = LoadedFromData;
+            } else {
+                data.clear();
+            }
         }
     }
 
-    if (image.isNull()) {
+    if (filenameType == NotLoaded) {
         const auto *file = qobject_cast<QFile *>(handler->device());
         if (file) {
             QUrl url(filename);
@@ -2964,23 +3197,25 @@ static QSvgNode *createImageNode(QSvgNode *parent,
             }
         }
 
-        if (handler->trustedSourceMode() || !QImageReader::imageFormat(filename).startsWith("svg")) {
-            image = QImage(filename);
+        QImageReader reader(filename);
+        if (reader.canRead()) {
+            format = reader.format();
             filenameType = LoadedFromFile;
         }
     }
 
-    if (image.isNull()) {
+    if (filenameType != NotLoaded && !handler->trustedSourceMode() && format.startsWith("svg"))
+        filenameType = NotLoaded;
+
+    if (filenameType == NotLoaded) {
         qCWarning(lcSvgHandler) << "Could not create image from" << filename;
         return 0;
     }
 
-    if (image.format() == QImage::Format_ARGB32)
-        image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-
     QSvgNode *img = new QSvgImage(parent,
-                                  image,
+                                  data,
                                   filenameType == LoadedFromFile ? filename : QString{},
+                                  format,
                                   QRectF(nx,
                                          ny,
                                          nwidth,
@@ -3226,6 +3461,18 @@ static QSvgNode *createMaskNode(QSvgNode *parent,
     return mask;
 }
 
+static QSvgNode *createClipPathNode(QSvgNode *parent,
+                                    const QXmlStreamAttributes &attributes,
+                                    QSvgHandler *)
+{
+    const QStringView cpU = attributes.value(QLatin1String("clipPathUnits"));
+
+    QtSvg::UnitTypes clipPathUnits = cpU.contains(QLatin1String("objectBoundingBox")) ?
+                QtSvg::UnitTypes::objectBoundingBox : QtSvg::UnitTypes::userSpaceOnUse;
+
+    return new QSvgClipPath(parent, clipPathUnits);
+}
+
 static void parseFilterBounds(QSvgNode *, const QXmlStreamAttributes &attributes,
                               QSvgHandler *handler, QSvgRectF *rect)
 {
@@ -3298,6 +3545,7 @@ static QSvgNode *createFilterNode(QSvgNode *parent,
 {
     QString fU = attributes.value(QLatin1String("filterUnits")).toString();
     QString pU = attributes.value(QLatin1String("primitiveUnits")).toString();
+    const QStringView cif = attributes.value(QLatin1String("color-interpolation-filters"));
 
     QtSvg::UnitTypes filterUnits = fU.contains(QLatin1String("userSpaceOnUse")) ?
                 QtSvg::UnitTypes::userSpaceOnUse : QtSvg::UnitTypes::objectBoundingBox;
@@ -3323,7 +3571,14 @@ static QSvgNode *createFilterNode(QSvgNode *parent,
 
     parseFilterBounds(parent, attributes, handler, &rect);
 
-    QSvgNode *filter = new QSvgFilterContainer(parent, rect, filterUnits, primitiveUnits);
+    QSvgFilterContainer::ColorInterpolation colorInterpolation = QSvgFilterContainer::ColorInterpolation::Auto;
+    if (cif == QLatin1String("sRGB"))
+        colorInterpolation = QSvgFilterContainer::ColorInterpolation::SRgb;
+    else if (cif == QLatin1String("linearRGB"))
+        colorInterpolation = QSvgFilterContainer::ColorInterpolation::LinearRgb;
+
+    QSvgNode *filter = new QSvgFilterContainer(parent, rect, filterUnits, primitiveUnits,
+                                               colorInterpolation);
     return filter;
 }
 
@@ -3606,6 +3861,211 @@ static QSvgNode *createFeBlendNode(QSvgNode *parent,
     return filter;
 }
 
+static QSvgNode *createFeTurbulenceNode(QSvgNode *parent,
+                                        const QXmlStreamAttributes &attributes,
+                                        QSvgHandler *handler)
+{
+    const QString baseFrequencyString = attributes.value(QLatin1String("baseFrequency")).toString();
+    const QStringView numOctavesString = attributes.value(QLatin1String("numOctaves"));
+    const QStringView seedString = attributes.value(QLatin1String("seed"));
+    const QStringView stitchTilesString = attributes.value(QLatin1String("stitchTiles"));
+    const QStringView typeString = attributes.value(QLatin1String("type"));
+
+    QString inputString;
+    QString outputString;
+    QSvgRectF rect;
+
+    parseFilterAttributes(parent, attributes, handler,
+                          &inputString, &outputString, &rect);
+
+    qreal baseFrequencyX = 0;
+    qreal baseFrequencyY = 0;
+    static QRegularExpression delimiterRE(QLatin1String("[,\\s]"));
+    const QStringList frequencyList = baseFrequencyString.split(delimiterRE, Qt::SkipEmptyParts);
+    if (!frequencyList.isEmpty()) {
+        baseFrequencyX = toDouble(frequencyList.first());
+        baseFrequencyY = frequencyList.size() > 1 ? toDouble(frequencyList.at(1)) : baseFrequencyX;
+    }
+
+    // A negative base frequency is an error
+    if (baseFrequencyX < 0 || baseFrequencyY < 0)
+        return new QSvgFeUnsupported(parent, inputString, outputString, rect);
+
+    int numOctaves = 1;
+    if (!numOctavesString.isEmpty()) {
+        bool ok;
+        const qreal v = toDouble(numOctavesString, &ok);
+        if (ok)
+            numOctaves = int(qBound(qreal(0), v, qreal(QSvgFeTurbulence::MaxOctaves)));
+    }
+
+    const qreal seed = toDouble(seedString);
+    const bool stitchTiles = stitchTilesString == QLatin1String("stitch");
+    const QSvgFeTurbulence::NoiseType noiseType = typeString == QLatin1String("fractalNoise")
+            ? QSvgFeTurbulence::NoiseType::FractalNoise
+            : QSvgFeTurbulence::NoiseType::Turbulence;
+
+    QSvgNode *filter = new QSvgFeTurbulence(parent, inputString, outputString, rect,
+                                            baseFrequencyX, baseFrequencyY, numOctaves,
+                                            seed, stitchTiles, noiseType);
+    return filter;
+}
+
+static QSvgNode *createFeConvolveMatrixNode(QSvgNode *parent,
+                                            const QXmlStreamAttributes &attributes,
+                                            QSvgHandler *handler)
+{
+    const QString orderString = attributes.value(QLatin1String("order")).toString();
+    const QString kernelMatrixString = attributes.value(QLatin1String("kernelMatrix")).toString();
+    const QStringView divisorString = attributes.value(QLatin1String("divisor"));
+    const QStringView biasString = attributes.value(QLatin1String("bias"));
+    const QStringView targetXString = attributes.value(QLatin1String("targetX"));
+    const QStringView targetYString = attributes.value(QLatin1String("targetY"));
+    const QStringView edgeModeString = attributes.value(QLatin1String("edgeMode"));
+    const QStringView preserveAlphaString = attributes.value(QLatin1String("preserveAlpha"));
+
+    QString inputString;
+    QString outputString;
+    QSvgRectF rect;
+
+    parseFilterAttributes(parent, attributes, handler,
+                          &inputString, &outputString, &rect);
+
+    static QRegularExpression delimiterRE(QLatin1String("[,\\s]"));
+
+    QSize order(3, 3);
+    const QStringList orderList = orderString.split(delimiterRE, Qt::SkipEmptyParts);
+    if (!orderList.isEmpty()) {
+        bool okX;
+        bool okY = true;
+        order.setWidth(orderList.first().toInt(&okX));
+        order.setHeight(orderList.size() > 1 ? orderList.at(1).toInt(&okY) : order.width());
+        if (!okX || !okY)
+            order = QSize();
+    }
+
+    QList<qreal> kernel;
+    const QStringList kernelList = kernelMatrixString.split(delimiterRE, Qt::SkipEmptyParts);
+    kernel.reserve(kernelList.size());
+    qreal kernelSum = 0;
+    for (const QString &value : kernelList) {
+        bool ok;
+        const qreal v = toDouble(value, &ok);
+        if (!ok)
+            return new QSvgFeUnsupported(parent, inputString, outputString, rect);
+        kernel.append(v);
+        kernelSum += v;
+    }
+
+    // The order has to be positive and match the number of kernel values
+    if (order.width() <= 0 || order.height() <= 0
+        || kernel.size() != qsizetype(order.width()) * order.height()) {
+        return new QSvgFeUnsupported(parent, inputString, outputString, rect);
+    }
+
+    // A missing or zero divisor defaults to the sum of the kernel values, or 1 if that is zero
+    bool ok;
+    qreal divisor = toDouble(divisorString, &ok);
+    if (!ok || divisor == 0)
+        divisor = kernelSum != 0 ? kernelSum : 1;
+
+    const qreal bias = toDouble(biasString);
+
+    QPoint target(order.width() / 2, order.height() / 2);
+    if (!targetXString.isEmpty())
+        target.setX(targetXString.toInt(&ok));
+    if (!targetXString.isEmpty() && !ok)
+        target.setX(-1);
+    if (!targetYString.isEmpty())
+        target.setY(targetYString.toInt(&ok));
+    if (!targetYString.isEmpty() && !ok)
+        target.setY(-1);
+    if (target.x() < 0 || target.x() >= order.width()
+        || target.y() < 0 || target.y() >= order.height()) {
+        return new QSvgFeUnsupported(parent, inputString, outputString, rect);
+    }
+
+    QSvgFeConvolveMatrix::EdgeMode edgeMode = QSvgFeConvolveMatrix::EdgeMode::Duplicate;
+    if (edgeModeString.startsWith(QLatin1String("wrap")))
+        edgeMode = QSvgFeConvolveMatrix::EdgeMode::Wrap;
+    else if (edgeModeString.startsWith(QLatin1String("none")))
+        edgeMode = QSvgFeConvolveMatrix::EdgeMode::None;
+
+    const bool preserveAlpha = preserveAlphaString == QLatin1String("true");
+
+    QSvgNode *filter = new QSvgFeConvolveMatrix(parent, inputString, outputString, rect,
+                                                order, kernel, divisor, bias, target,
+                                                edgeMode, preserveAlpha);
+    return filter;
+}
+
+static QSvgNode *createFeMorphologyNode(QSvgNode *parent,
+                                        const QXmlStreamAttributes &attributes,
+                                        QSvgHandler *handler)
+{
+    const QStringView operatorString = attributes.value(QLatin1String("operator"));
+    const QString radiusString = attributes.value(QLatin1String("radius")).toString();
+
+    QString inputString;
+    QString outputString;
+    QSvgRectF rect;
+
+    parseFilterAttributes(parent, attributes, handler,
+                          &inputString, &outputString, &rect);
+
+    QSvgFeMorphology::Operator op = QSvgFeMorphology::Operator::Erode;
+    if (operatorString.startsWith(QLatin1String("dilate")))
+        op = QSvgFeMorphology::Operator::Dilate;
+
+    qreal radiusX = 0;
+    qreal radiusY = 0;
+    static QRegularExpression delimiterRE(QLatin1String("[,\\s]"));
+    const QStringList radiusList = radiusString.split(delimiterRE, Qt::SkipEmptyParts);
+    if (!radiusList.isEmpty()) {
+        radiusX = toDouble(radiusList.first());
+        radiusY = radiusList.size() > 1 ? toDouble(radiusList.at(1)) : radiusX;
+    }
+
+    QSvgNode *filter = new QSvgFeMorphology(parent, inputString, outputString, rect,
+                                            op, radiusX, radiusY);
+    return filter;
+}
+
+static QSvgNode *createFeDisplacementMapNode(QSvgNode *parent,
+                                             const QXmlStreamAttributes &attributes,
+                                             QSvgHandler *handler)
+{
+    QString in2String = attributes.value(QLatin1String("in2")).toString();
+    const QStringView scaleString = attributes.value(QLatin1String("scale"));
+    const QStringView xChannelString = attributes.value(QLatin1String("xChannelSelector"));
+    const QStringView yChannelString = attributes.value(QLatin1String("yChannelSelector"));
+
+    QString inputString;
+    QString outputString;
+    QSvgRectF rect;
+
+    parseFilterAttributes(parent, attributes, handler,
+                          &inputString, &outputString, &rect);
+
+    auto parseChannel = [](QStringView channel) {
+        if (channel == QLatin1String("R"))
+            return QSvgFeDisplacementMap::Channel::R;
+        if (channel == QLatin1String("G"))
+            return QSvgFeDisplacementMap::Channel::G;
+        if (channel == QLatin1String("B"))
+            return QSvgFeDisplacementMap::Channel::B;
+        return QSvgFeDisplacementMap::Channel::A;
+    };
+
+    const qreal scale = toDouble(scaleString);
+
+    QSvgNode *filter = new QSvgFeDisplacementMap(parent, inputString, outputString, rect,
+                                                 in2String, scale,
+                                                 parseChannel(xChannelString),
+                                                 parseChannel(yChannelString));
+    return filter;
+}
+
 static QSvgNode *createFeUnsupportedNode(QSvgNode *parent,
                                          const QXmlStreamAttributes &attributes,
                                          QSvgHandler *handler)
@@ -4325,6 +4785,7 @@ static QSvgNode *createUseNode(QSvgNode *parent,
     case QSvgNode::Group:
     case QSvgNode::Switch:
     case QSvgNode::Mask:
+    case QSvgNode::ClipPath:
         group = static_cast<QSvgStructureNode*>(parent);
         break;
     default:
@@ -4376,6 +4837,9 @@ static FactoryMethod findGroupFactory(const QString &name, QtSvg::Options option
 
     QStringView ref = QStringView{name}.mid(1, name.size() - 1);
     switch (name.at(0).unicode()) {
+    case 'c':
+        if (ref == QLatin1String("lipPath") && !options.testFlag(QtSvg::Tiny12FeaturesOnly)) return createClipPathNode;
+        break;
     case 'd':
         if (ref == QLatin1String("efs")) return createDefsNode;
         break;
@@ -4467,22 +4931,22 @@ static FactoryMethod findFilterFactory(const QString &name, QtSvg::Options optio
     if (name == QLatin1String("feComposite")) return createFeCompositeNode;
     if (name == QLatin1String("feFlood")) return createFeFloodNode;
     if (name == QLatin1String("feBlend")) return createFeBlendNode;
+    if (name == QLatin1String("feTurbulence")) return createFeTurbulenceNode;
+    if (name == QLatin1String("feConvolveMatrix")) return createFeConvolveMatrixNode;
+    if (name == QLatin1String("feMorphology")) return createFeMorphologyNode;
+    if (name == QLatin1String("feDisplacementMap")) return createFeDisplacementMapNode;
 
     static const QStringList unsupportedFilters = {
         QStringLiteral("feComponentTransfer"),
-        QStringLiteral("feConvolveMatrix"),
         QStringLiteral("feDiffuseLighting"),
-        QStringLiteral("feDisplacementMap"),
         QStringLiteral("feDropShadow"),
         QStringLiteral("feFuncA"),
         QStringLiteral("feFuncB"),
         QStringLiteral("feFuncG"),
         QStringLiteral("feFuncR"),
         QStringLiteral("feImage"),
-        QStringLiteral("feMorphology"),
         QStringLiteral("feSpecularLighting"),
-        QStringLiteral("feTile"),
-        QStringLiteral("feTurbulence")
+        QStringLiteral("feTile")
     };
 
     if (unsupportedFilters.contains(name))
@@ -4778,6 +5242,10 @@ void QSvgHandler::parse()
     }
     resolvePaintServers(m_doc);
     resolveNodes();
+    qCDebug(lcSvgHandler) << "Created" << m_sharedStyles.size() << "shared style properties for"
+                          << m_sharedStyles.size() + m_sharedStyleHits << "elements, saving about"
+                          << m_sharedStyleBytes << "bytes";
+    m_sharedStyles.clear();
     if (detectCycles(m_doc)) {
         qCWarning(lcSvgHandler, "Cycles detected in SVG, document discarded.");
         delete m_doc;
@@ -4841,6 +5309,7 @@ bool QSvgHandler::startElement(const QString &localName,
                 case QSvgNode::Symbol:
                 case QSvgNode::Marker:
                 case QSvgNode::Pattern:
+                case QSvgNode::ClipPath:
                 {
                     QSvgStructureNode *group =
                         static_cast<QSvgStructureNode*>(m_nodes.top());
@@ -4880,6 +5349,7 @@ bool QSvgHandler::startElement(const QString &localName,
             case QSvgNode::Symbol:
             case QSvgNode::Marker:
             case QSvgNode::Pattern:
+            case QSvgNode::ClipPath:
             {
                 if (node->type() == QSvgNode::Tspan) {
                     const QByteArray msg = QByteArrayLiteral("\'tspan\' element in wrong context.");
@@ -5099,10 +5569,7 @@ bool QSvgHandler::characters(const QStringView str)
 {
 #ifndef QT_NO_CSSPARSER
     if (m_inStyle) {
-        QString css = str.toString();
-        QCss::StyleSheet sheet;
-        QCss::Parser(css).parse(&sheet);
-        m_selector->styleSheets.append(sheet);
+        m_selector->addStyleSheet(str.toString());
         return true;
     }
 #endif
@@ -5221,11 +5688,7 @@ bool QSvgHandler::processingInstruction(const QString &target, const QString &da
                     return true;
                 }
                 QByteArray cssData = file.readAll();
-                QString css = QString::fromUtf8(cssData);
-
-                QCss::StyleSheet sheet;
-                QCss::Parser(css).parse(&sheet);
-                m_selector->styleSheets.append(sheet);
+                m_selector->addStyleSheet(QString::fromUtf8(cssData));
             }
 
         }
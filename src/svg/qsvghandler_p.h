@@ -102,6 +102,9 @@ public:
     QtSvg::Options options() const;
     bool trustedSourceMode() const;
 
+    QSvgStyleProperty *sharedStyleProperty(const QString &key);
+    void addSharedStyleProperty(const QString &key, QSvgStyleProperty *prop, qsizetype size);
+
 public:
     bool startElement(const QString &localName, const QXmlStreamAttributes &attributes);
     bool endElement(QStringView localName);
@@ -136,6 +139,17 @@ private:
 
     QSvgRefCounter<QSvgStyleProperty> m_style;
 
+    // Fill, stroke and font properties parsed from identical attribute values,
+    // shared between all elements using them. Only needed during parsing.
+    struct SharedStyleProperty
+    {
+        QSvgRefCounter<QSvgStyleProperty> property;
+        qsizetype size;
+    };
+    QHash<QString, SharedStyleProperty> m_sharedStyles;
+    qsizetype m_sharedStyleHits = 0;
+    qsizetype m_sharedStyleBytes = 0;
+
     LengthType m_defaultCoords;
 
     QStack<QColor> m_colorStack;
@@ -8,10 +8,12 @@
 #include <QLoggingCategory>
 #include<QElapsedTimer>
 #include <QtGui/qimageiohandler.h>
+#include <QtGui/qpixmap.h>
 
 #include "qdebug.h"
 #include "qstack.h"
 
+#include <QtCore/private/qsimd_p.h>
 #include <QtGui/private/qoutlinemapper_p.h>
 
 QT_BEGIN_NAMESPACE
@@ -36,6 +38,64 @@ QSvgNode::~QSvgNode()
 
 }
 
+// Returns the area of the paint device that painting can affect, in the coordinate
+// system the painter's world transform maps into, or a null rect if it is unknown.
+static QRectF visibleDeviceRegion(QPainter *p)
+{
+    QRectF region;
+    const QPaintDevice *device = p->device();
+    const bool hasViewTransform = p->viewTransformEnabled() && p->window() != p->viewport();
+    if (device && !hasViewTransform) {
+        if (device->devType() == QInternal::Image)
+            region = QRectF(QPointF(0, 0), static_cast<const QImage *>(device)->deviceIndependentSize());
+        else if (device->devType() == QInternal::Pixmap)
+            region = QRectF(QPointF(0, 0), static_cast<const QPixmap *>(device)->deviceIndependentSize());
+    }
+
+    if (p->hasClipping()) {
+        const QRectF clipRect = p->transform().mapRect(p->clipBoundingRect());
+        region = region.isNull() ? clipRect : region.intersected(clipRect);
+    }
+
+    return region.isNull() ? region : QRectF(region.toAlignedRect());
+}
+
+static bool isAxisAlignedRect(const QPainterPath &path)
+{
+    if (path.elementCount() != 5)
+        return false;
+    const QRectF rect = path.boundingRect();
+    for (int i = 0; i < path.elementCount(); ++i) {
+        const QPainterPath::Element e = path.elementAt(i);
+        if (i == 0 ? !e.isMoveTo() : !e.isLineTo())
+            return false;
+        if ((e.x != rect.left() && e.x != rect.right()) || (e.y != rect.top() && e.y != rect.bottom()))
+            return false;
+    }
+    return true;
+}
+
+// Intersects the clip of the painter with clip, given in the current user space
+static void intersectClip(QPainter *p, const QPainterPath &clip)
+{
+    if (isAxisAlignedRect(clip) && p->transform().type() <= QTransform::TxScale)
+        p->setClipRect(clip.boundingRect(), Qt::IntersectClip);
+    else
+        p->setClipPath(clip, Qt::IntersectClip);
+}
+
+// Clips are not antialiased, so masks are only replaced by a clip if antialiasing is off
+// anyway, or if the clip is a rectangle on the device pixel grid
+static bool canClipWithoutLoss(QPainter *p, const QPainterPath &clip)
+{
+    if (!p->testRenderHint(QPainter::Antialiasing))
+        return true;
+    if (!isAxisAlignedRect(clip) || p->transform().type() > QTransform::TxScale)
+        return false;
+    const QRectF deviceRect = p->transform().mapRect(clip.boundingRect());
+    return deviceRect == QRectF(deviceRect.toAlignedRect());
+}
+
 void QSvgNode::draw(QPainter *p, QSvgExtraStates &states)
 {
 #ifndef QT_NO_DEBUG
@@ -47,23 +107,70 @@ void QSvgNode::draw(QPainter *p, QSvgExtraStates &states)
         if (document()->animated())
             document()->animator()->applyAnimationsOnNode(this, p);
         QSvgNode *maskNode = this->hasMask() ? document()->namedNode(this->maskId()) : nullptr;
+        QSvgNode *clipNode = this->hasClipPath() ? document()->namedNode(this->clipPathId()) : nullptr;
+        if (clipNode && clipNode->type() != QSvgNode::ClipPath)
+            clipNode = nullptr;
+        QPainterPath clip;
+        if (clipNode) {
+            bool ok = true;
+            clip = static_cast<QSvgClipPath *>(clipNode)->clipPath(p, states, this, &ok);
+            if (!ok) {
+                qCWarning(lcSvgDraw) << "Clip path" << clipPathId()
+                                     << "has content without a geometric outline, ignoring";
+                clipNode = nullptr;
+            }
+        }
+        // Masks with only opaque white content are applied as vector clips, like clip paths
+        QPainterPath maskClip;
+        bool clipWithMask = false;
+        if (maskNode && maskNode->type() == QSvgNode::Mask && static_cast<QSvgMask *>(maskNode)->isBinary()) {
+            maskClip = static_cast<QSvgMask *>(maskNode)->clipPath(p, states, this);
+            clipWithMask = canClipWithoutLoss(p, maskClip);
+            if (clipWithMask)
+                maskNode = nullptr;
+        }
+        const bool clipped = clipNode || clipWithMask;
+        if (clipped) {
+            p->save();
+            if (clipNode)
+                intersectClip(p, clip);
+            if (clipWithMask)
+                intersectClip(p, maskClip);
+        }
         QSvgFilterContainer *filterNode = this->hasFilter() ? static_cast<QSvgFilterContainer*>(document()->namedNode(this->filterId()))
                                                             : nullptr;
         if (filterNode && filterNode->type() == QSvgNode::Filter && filterNode->supported()) {
-            QTransform xf = p->transform();
-            p->resetTransform();
-            QRectF localRect = internalBounds(p, states);
-            p->setTransform(xf);
-            QRectF boundsRect = xf.mapRect(filterNode->filterRegion(localRect));
-            QImage proxy = drawIntoBuffer(p, states, boundsRect.toRect());
-            proxy = filterNode->applyFilter(proxy, p, localRect);
-            if (maskNode && maskNode->type() == QSvgNode::Mask) {
-                boundsRect = QRectF(proxy.offset(), proxy.size());
-                localRect = p->transform().inverted().mapRect(boundsRect);
-                QImage mask = static_cast<QSvgMask*>(maskNode)->createMask(p, states, localRect, &boundsRect);
-                applyMaskToBuffer(&proxy, mask);
+            // Only render and filter what can actually become visible on the device
+            const QRectF targetRect = visibleDeviceRegion(p);
+            // During animations, reuse the result of a previous frame if nothing changed.
+            // Masks are applied on the device pixel grid, so they need a fresh result.
+            const bool hasMask = maskNode && maskNode->type() == QSvgNode::Mask;
+            QPointF cachedPosition;
+            QImage proxy = hasMask ? QImage()
+                                   : filterNode->cachedResult(this, p, states, targetRect, &cachedPosition);
+            if (!proxy.isNull()) {
+                applyBufferToCanvas(p, proxy, cachedPosition);
+            } else {
+                QTransform xf = p->transform();
+                p->resetTransform();
+                QRectF localRect = internalBounds(p, states);
+                p->setTransform(xf);
+                const QRect sourceRect = filterNode->sourceRegion(p, localRect, targetRect);
+                if (!sourceRect.isEmpty())
+                    proxy = drawIntoBuffer(p, states, sourceRect);
+                proxy = filterNode->applyFilter(proxy, p, localRect, targetRect);
+                if (!hasMask)
+                    filterNode->cacheResult(this, p, states, targetRect, proxy);
+                if (!proxy.isNull()) {
+                    if (hasMask) {
+                        QRectF boundsRect = QRectF(proxy.offset(), proxy.size());
+                        localRect = p->transform().inverted().mapRect(boundsRect);
+                        QImage mask = static_cast<QSvgMask*>(maskNode)->createMask(p, states, localRect, &boundsRect);
+                        applyMaskToBuffer(&proxy, mask);
+                    }
+                    applyBufferToCanvas(p, proxy);
+                }
             }
-            applyBufferToCanvas(p, proxy);
 
         } else if (maskNode && maskNode->type() == QSvgNode::Mask) {
             QRectF boundsRect;
@@ -91,6 +198,8 @@ void QSvgNode::draw(QPainter *p, QSvgExtraStates &states)
                 drawCommand(p, states);
 
         }
+        if (clipped)
+            p->restore();
         revertStyle(p, states);
     }
 
@@ -160,12 +269,136 @@ QImage QSvgNode::drawIntoBuffer(QPainter *p, QSvgExtraStates &states, const QRec
     return proxy;
 }
 
+// luminanceToAlpha following SVG 1.1, in 8 bit fixed point. The coefficients
+// sum up to 256, so white maps to 255. The mask content is premultiplied,
+// which folds the multiplication with its alpha into the luminance.
+static constexpr uint lumR = 54; // 0.2125
+static constexpr uint lumG = 183; // 0.7154
+static constexpr uint lumB = 19; // 0.0721
+
+static inline uint maskLuminance(QRgb maskPixel)
+{
+    return (qRed(maskPixel) * lumR + qGreen(maskPixel) * lumG + qBlue(maskPixel) * lumB + 128) >> 8;
+}
+
+static inline uint byteMul(uint x, uint a)
+{
+    uint t = (x & 0xff00ff) * a;
+    t = (t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8;
+    t &= 0xff00ff;
+    x = ((x >> 8) & 0xff00ff) * a;
+    x = (x + ((x >> 8) & 0xff00ff) + 0x800080);
+    x &= 0xff00ff00;
+    return x | t;
+}
+
+#ifdef __SSE2__
+// Multiplies four premultiplied pixels by the alpha values in the 16 bit lanes of alpha
+static inline __m128i byteMulSse2(__m128i pixels, __m128i alpha)
+{
+    const __m128i colorMask = _mm_set1_epi32(0x00ff00ff);
+    const __m128i half = _mm_set1_epi16(0x80);
+    __m128i ag = _mm_mullo_epi16(_mm_srli_epi16(pixels, 8), alpha);
+    __m128i rb = _mm_mullo_epi16(_mm_and_si128(pixels, colorMask), alpha);
+    ag = _mm_add_epi16(_mm_add_epi16(ag, _mm_srli_epi16(ag, 8)), half);
+    rb = _mm_add_epi16(_mm_add_epi16(rb, _mm_srli_epi16(rb, 8)), half);
+    return _mm_or_si128(_mm_andnot_si128(colorMask, ag), _mm_srli_epi16(rb, 8));
+}
+#endif
+
+static inline void applyMaskValue(QRgb *pixel, uint value)
+{
+    if (value == 0)
+        *pixel = 0;
+    else if (value != 255)
+        *pixel = byteMul(*pixel, value);
+}
+
+#ifdef __SSE2__
+// Applies the mask values in the 32 bit lanes of values to four pixels
+static inline void applyMaskValuesSse2(QRgb *dst, __m128i pixels, __m128i values)
+{
+    const __m128i zero = _mm_setzero_si128();
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(values, _mm_set1_epi32(255))) == 0xffff)
+        return;
+    __m128i result = zero;
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(values, zero)) != 0xffff)
+        result = byteMulSse2(pixels, _mm_or_si128(values, _mm_slli_epi32(values, 16)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), result);
+}
+#endif
+
+static void applyMaskLine(QRgb *dst, const QRgb *mask, int length)
+{
+    int x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i channelMask = _mm_set1_epi32(0xff);
+    const __m128i rounding = _mm_set1_epi32(128);
+    const __m128i coeffR = _mm_set1_epi32(lumR);
+    const __m128i coeffG = _mm_set1_epi32(lumG);
+    const __m128i coeffB = _mm_set1_epi32(lumB);
+    for (; x + 4 <= length; x += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(pixels, zero)) == 0xffff)
+            continue;
+        // Each 32 bit lane only uses its lower 16 bits, so 16 bit arithmetic suffices
+        const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + x));
+        const __m128i r = _mm_and_si128(_mm_srli_epi32(m, 16), channelMask);
+        const __m128i g = _mm_and_si128(_mm_srli_epi32(m, 8), channelMask);
+        const __m128i b = _mm_and_si128(m, channelMask);
+        __m128i lum = _mm_add_epi16(_mm_mullo_epi16(r, coeffR), _mm_mullo_epi16(g, coeffG));
+        lum = _mm_add_epi16(lum, _mm_add_epi16(_mm_mullo_epi16(b, coeffB), rounding));
+        applyMaskValuesSse2(dst + x, pixels, _mm_srli_epi16(lum, 8));
+    }
+#endif
+    for (; x < length; ++x) {
+        if (dst[x])
+            applyMaskValue(dst + x, maskLuminance(mask[x]));
+    }
+}
+
+// Grayscale masks already hold the luminance multiplied by the alpha of the content
+static void applyCoverageLine(QRgb *dst, const uchar *coverage, int length)
+{
+    int x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 4 <= length; x += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(pixels, zero)) == 0xffff)
+            continue;
+        int values;
+        memcpy(&values, coverage + x, sizeof(int));
+        const __m128i c = _mm_unpacklo_epi8(_mm_cvtsi32_si128(values), zero);
+        applyMaskValuesSse2(dst + x, pixels, _mm_unpacklo_epi16(c, zero));
+    }
+#endif
+    for (; x < length; ++x) {
+        if (dst[x])
+            applyMaskValue(dst + x, coverage[x]);
+    }
+}
+
 void QSvgNode::applyMaskToBuffer(QImage *proxy, QImage mask) const
 {
-    QPainter proxyPainter(proxy);
-    proxyPainter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-    proxyPainter.resetTransform();
-    proxyPainter.drawImage(QRect(0, 0, mask.width(), mask.height()), mask);
+    // Luminance and alpha multiplication are done in a single pass over both buffers,
+    // which share the premultiplied format of the raster engine.
+    if (proxy->format() != QImage::Format_ARGB32_Premultiplied)
+        proxy->convertTo(QImage::Format_ARGB32_Premultiplied);
+    const bool coverage = mask.format() == QImage::Format_Grayscale8;
+    if (!coverage && mask.format() != QImage::Format_ARGB32_Premultiplied)
+        mask.convertTo(QImage::Format_ARGB32_Premultiplied);
+
+    const int width = qMin(proxy->width(), mask.width());
+    const int height = qMin(proxy->height(), mask.height());
+    for (int y = 0; y < height; ++y) {
+        QRgb *dst = reinterpret_cast<QRgb *>(proxy->scanLine(y));
+        if (coverage)
+            applyCoverageLine(dst, mask.constScanLine(y), width);
+        else
+            applyMaskLine(dst, reinterpret_cast<const QRgb *>(mask.constScanLine(y)), width);
+    }
 }
 
 void QSvgNode::applyBufferToCanvas(QPainter *p, QImage proxy) const
@@ -176,6 +409,14 @@ void QSvgNode::applyBufferToCanvas(QPainter *p, QImage proxy) const
     p->setTransform(xf);
 }
 
+void QSvgNode::applyBufferToCanvas(QPainter *p, const QImage &proxy, const QPointF &position) const
+{
+    QTransform xf = p->transform();
+    p->resetTransform();
+    p->drawImage(position, proxy);
+    p->setTransform(xf);
+}
+
 bool QSvgNode::isDescendantOf(const QSvgNode *parent) const
 {
     const QSvgNode *n = this;
@@ -225,12 +466,24 @@ void QSvgNode::appendStyleProperty(QSvgStyleProperty *prop, const QString &id)
         if (doc && !id.isEmpty())
             doc->addNamedStyle(id, m_style.pattern);
         break;
-    case QSvgStyleProperty::TRANSFORM:
-        m_style.transform = static_cast<QSvgTransformStyle*>(prop);
+    case QSvgStyleProperty::TRANSFORM: {
+        // Identity transforms and full opacity are dropped, so that drawing doesn't
+        // apply and revert them. They still replace a property set earlier, e.g. by CSS.
+        QSvgRefCounter<QSvgTransformStyle> transform = static_cast<QSvgTransformStyle*>(prop);
+        if (transform.isDefault())
+            m_style.transform = nullptr;
+        else
+            m_style.transform = transform;
         break;
-    case QSvgStyleProperty::OPACITY:
-        m_style.opacity = static_cast<QSvgOpacityStyle*>(prop);
+    }
+    case QSvgStyleProperty::OPACITY: {
+        QSvgRefCounter<QSvgOpacityStyle> opacity = static_cast<QSvgOpacityStyle*>(prop);
+        if (opacity.isDefault())
+            m_style.opacity = nullptr;
+        else
+            m_style.opacity = opacity;
         break;
+    }
     case QSvgStyleProperty::COMP_OP:
         m_style.compop = static_cast<QSvgCompOpStyle*>(prop);
         break;
@@ -407,6 +660,7 @@ QString QSvgNode::typeName() const
         case Symbol: return QStringLiteral("symbol");
         case Marker: return QStringLiteral("marker");
         case Pattern: return QStringLiteral("pattern");
+        case ClipPath: return QStringLiteral("clipPath");
         case Filter: return QStringLiteral("filter");
         case FeMerge: return QStringLiteral("feMerge");
         case FeMergenode: return QStringLiteral("feMergeNode");
@@ -416,6 +670,10 @@ QString QSvgNode::typeName() const
         case FeComposite: return QStringLiteral("feComposite");
         case FeFlood: return QStringLiteral("feFlood");
         case FeBlend: return QStringLiteral("feBlend");
+        case FeTurbulence: return QStringLiteral("feTurbulence");
+        case FeConvolvematrix: return QStringLiteral("feConvolveMatrix");
+        case FeMorphology: return QStringLiteral("feMorphology");
+        case FeDisplacementmap: return QStringLiteral("feDisplacementMap");
         case FeUnsupported: return QStringLiteral("feUnsupported");
     }
     return QStringLiteral("unknown");
@@ -548,6 +806,23 @@ bool QSvgNode::hasFilter() const
     return !m_filterId.isEmpty();
 }
 
+QString QSvgNode::clipPathId() const
+{
+    return m_clipPathId;
+}
+
+void QSvgNode::setClipPathId(const QString &str)
+{
+    m_clipPathId = str;
+}
+
+bool QSvgNode::hasClipPath() const
+{
+    if (document()->options().testFlag(QtSvg::Tiny12FeaturesOnly))
+        return false;
+    return !m_clipPathId.isEmpty();
+}
+
 QString QSvgNode::markerStartId() const
 {
     return m_markerStartId;
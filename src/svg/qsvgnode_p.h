@@ -55,6 +55,7 @@ public:
         Symbol,
         Marker,
         Pattern,
+        ClipPath,
         Filter,
         FeMerge,
         FeMergenode,
@@ -64,6 +65,10 @@ public:
         FeComposite,
         FeFlood,
         FeBlend,
+        FeTurbulence,
+        FeConvolvematrix,
+        FeMorphology,
+        FeDisplacementmap,
         FeUnsupported
     };
     enum DisplayMode {
@@ -98,6 +103,7 @@ public:
     void applyMaskToBuffer(QImage *proxy, QImage mask) const;
     void drawWithMask(QPainter *p, QSvgExtraStates &states, const QImage &mask, const QRect &boundsRect);
     void applyBufferToCanvas(QPainter *p, QImage proxy) const;
+    void applyBufferToCanvas(QPainter *p, const QImage &proxy, const QPointF &position) const;
 
     QSvgNode *parent() const;
     bool isDescendantOf(const QSvgNode *parent) const;
@@ -156,6 +162,10 @@ public:
     void setFilterId(const QString &str);
     bool hasFilter() const;
 
+    QString clipPathId() const;
+    void setClipPathId(const QString &str);
+    bool hasClipPath() const;
+
     QString markerStartId() const;
     void setMarkerStartId(const QString &str);
     bool hasMarkerStart() const;
@@ -204,6 +214,7 @@ private:
     QString m_class;
     QString m_maskId;
     QString m_filterId;
+    QString m_clipPathId;
     QString m_markerStartId;
     QString m_markerMidId;
     QString m_markerEndId;
@@ -16,7 +16,11 @@
 
 #include <QLoggingCategory>
 #include <qscopedvaluerollback.h>
+#include <QtGui/qcolorspace.h>
+#include <QtGui/qcolortransform.h>
 #include <QtGui/qimageiohandler.h>
+#include <QtGui/qpaintengine.h>
+#include <QtGui/qrgbafloat.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -223,11 +227,13 @@ QSvgMarker::QSvgMarker(QSvgNode *parent, QRectF bounds, QRectF viewBox, QPointF
 }
 
 QSvgFilterContainer::QSvgFilterContainer(QSvgNode *parent, const QSvgRectF &bounds,
-                                         QtSvg::UnitTypes filterUnits, QtSvg::UnitTypes primitiveUnits)
+                                         QtSvg::UnitTypes filterUnits, QtSvg::UnitTypes primitiveUnits,
+                                         ColorInterpolation colorInterpolation)
     : QSvgStructureNode(parent)
     , m_rect(bounds)
     , m_filterUnits(filterUnits)
     , m_primitiveUnits(primitiveUnits)
+    , m_colorInterpolation(colorInterpolation)
     , m_supported(true)
 {
 
@@ -261,17 +267,7 @@ void QSvgMarker::drawCommand(QPainter *p, QSvgExtraStates &states)
     p->restore();
 }
 
-namespace {
-
-struct PositionMarkerPair {
-    qreal x;
-    qreal y;
-    qreal angle;
-    QString markerId;
-    bool isStartNode = false;
-};
-
-QList<PositionMarkerPair> markersForNode(const QSvgNode *node)
+QList<QSvgMarkerPlacement> QSvgMarker::placementsForNode(const QSvgNode *node)
 {
     if (!node->hasAnyMarker())
         return {};
@@ -293,18 +289,18 @@ QList<PositionMarkerPair> markersForNode(const QSvgNode *node)
         return -atan2(tangent.y(), tangent.x()) / M_PI * 180.;
     };
 
-    QList<PositionMarkerPair> markers;
+    QList<QSvgMarkerPlacement> markers;
 
     switch (node->type()) {
     case QSvgNode::Line: {
         const QSvgLine *line = static_cast<const QSvgLine*>(node);
         if (node->hasMarkerStart())
-            markers << PositionMarkerPair { line->line().p1().x(), line->line().p1().y(),
-                                            line->line().angle(), line->markerStartId(),
-                                            true};
+            markers << QSvgMarkerPlacement { line->line().p1(),
+                                             line->line().angle(), line->markerStartId(),
+                                             true };
         if (node->hasMarkerEnd())
-            markers << PositionMarkerPair { line->line().p2().x(), line->line().p2().y(),
-                                            line->line().angle(), line->markerEndId() };
+            markers << QSvgMarkerPlacement { line->line().p2(),
+                                             line->line().angle(), line->markerEndId() };
         break;
     }
     case QSvgNode::Polyline:
@@ -318,11 +314,10 @@ QList<PositionMarkerPair> markersForNode(const QSvgNode *node)
 
         if (node->hasMarkerStart() && polyData.size() > 1) {
             QLineF line(polyData.at(0), polyData.at(1));
-            markers << PositionMarkerPair { line.p1().x(),
-                                            line.p1().y(),
-                                            line.angle(),
-                                            node->markerStartId(),
-                                            true };
+            markers << QSvgMarkerPlacement { line.p1(),
+                                             line.angle(),
+                                             node->markerStartId(),
+                                             true };
         }
         if (node->hasMarkerMid()) {
             for (int i = 1; i < polyData.size() - 1; i++) {
@@ -330,29 +325,26 @@ QList<PositionMarkerPair> markersForNode(const QSvgNode *node)
                 QPointF p1 = polyData.at(i);
                 QPointF p2 = polyData.at(i + 1);
 
-                markers << PositionMarkerPair { p1.x(),
-                                                p1.y(),
-                                                getMeanAngle(p0, p1, p2),
-                                                node->markerStartId() };
+                markers << QSvgMarkerPlacement { p1,
+                                                 getMeanAngle(p0, p1, p2),
+                                                 node->markerStartId() };
             }
         }
         if (node->hasMarkerEnd() && polyData.size() > 1) {
             QLineF line(polyData.at(polyData.size() - 1), polyData.last());
-            markers << PositionMarkerPair { line.p2().x(),
-                                            line.p2().y(),
-                                            line.angle(),
-                                            node->markerEndId() };
+            markers << QSvgMarkerPlacement { line.p2(),
+                                             line.angle(),
+                                             node->markerEndId() };
         }
         break;
     }
     case QSvgNode::Path: {
         const QSvgPath *path = static_cast<const QSvgPath*>(node);
         if (node->hasMarkerStart())
-            markers << PositionMarkerPair { path->path().pointAtPercent(0.).x(),
-                                            path->path().pointAtPercent(0.).y(),
-                                            path->path().angleAtPercent(0.),
-                                            path->markerStartId(),
-                                            true };
+            markers << QSvgMarkerPlacement { path->path().pointAtPercent(0.),
+                                             path->path().angleAtPercent(0.),
+                                             path->markerStartId(),
+                                             true };
         if (node->hasMarkerMid()) {
             for (int i = 1; i < path->path().elementCount() - 1; i++) {
                 if (path->path().elementAt(i).type == QPainterPath::MoveToElement)
@@ -367,18 +359,16 @@ QList<PositionMarkerPair> markersForNode(const QSvgNode *node)
                     QPointF p1(path->path().elementAt(i).x, path->path().elementAt(i).y);
                     QPointF p2(path->path().elementAt(i + 1).x, path->path().elementAt(i + 1).y);
 
-                    markers << PositionMarkerPair { p1.x(),
-                                                    p1.y(),
-                                                    getMeanAngle(p0, p1, p2),
-                                                    path->markerMidId() };
+                    markers << QSvgMarkerPlacement { p1,
+                                                     getMeanAngle(p0, p1, p2),
+                                                     path->markerMidId() };
                 }
             }
         }
         if (node->hasMarkerEnd())
-            markers << PositionMarkerPair { path->path().pointAtPercent(1.).x(),
-                                            path->path().pointAtPercent(1.).y(),
-                                            path->path().angleAtPercent(1.),
-                                            path->markerEndId() };
+            markers << QSvgMarkerPlacement { path->path().pointAtPercent(1.),
+                                             path->path().angleAtPercent(1.),
+                                             path->markerEndId() };
         break;
     }
     default:
@@ -389,9 +379,6 @@ QList<PositionMarkerPair> markersForNode(const QSvgNode *node)
     return markers;
 }
 
-} // anonymous namespace
-
-
 void QSvgMarker::drawMarkersForNode(QSvgNode *node, QPainter *p, QSvgExtraStates &states)
 {
     drawHelper(node, p, states);
@@ -412,46 +399,261 @@ QSvgNode::Type QSvgMarker::type() const
 void QSvgMarker::drawHelper(const QSvgNode *node, QPainter *p,
                             QSvgExtraStates &states, QRectF *boundingRect)
 {
+    QSvgTinyDocument *doc = node->document();
+    if (!doc)
+        return;
+
     QScopedValueRollback<bool> inUseGuard(states.inUse, true);
 
-    const bool isPainting = (boundingRect == nullptr);
-    const auto markers = markersForNode(node);
-    for (auto &i : markers) {
-        QSvgMarker *markNode = static_cast<QSvgMarker*>(node->document()->namedNode(i.markerId));
-        if (!markNode)
-            continue;
+    const QList<QSvgMarkerPlacement> markers = doc->markerPlacements(node);
+    const QTransform xf = p->transform();
 
-        p->save();
-        p->translate(i.x, i.y);
-        if (markNode->orientation() == QSvgMarker::Orientation::Value) {
-            p->rotate(markNode->orientationAngle());
-        } else {
-            p->rotate(-i.angle);
-            if (i.isStartNode && markNode->orientation()
-                        == QSvgMarker::Orientation::AutoStartReverse) {
-                p->scale(-1, -1);
-            }
+    // Consecutive vertices sharing a marker, typically the mid markers, are handled
+    // as one run: the marker is looked up, sized and measured only once
+    qsizetype begin = 0;
+    while (begin < markers.size()) {
+        qsizetype end = begin + 1;
+        while (end < markers.size() && markers.at(end).markerId == markers.at(begin).markerId)
+            ++end;
+
+        QSvgNode *target = doc->namedNode(markers.at(begin).markerId);
+        if (!target || target->type() != QSvgNode::Marker) {
+            begin = end;
+            continue;
         }
+        QSvgMarker *markNode = static_cast<QSvgMarker *>(target);
+
         QRectF oldRect = markNode->m_rect;
         if (markNode->markerUnits() == QSvgMarker::MarkerUnits::StrokeWidth) {
             markNode->m_rect.setWidth(markNode->m_rect.width() * p->pen().widthF());
             markNode->m_rect.setHeight(markNode->m_rect.height() * p->pen().widthF());
         }
-        if (isPainting)
-            markNode->draw(p, states);
 
         if (boundingRect) {
-            QTransform xf = p->transform();
             p->resetTransform();
-            *boundingRect |=  xf.mapRect(markNode->decoratedInternalBounds(p, states));
+            const QRectF localBounds = markNode->decoratedInternalBounds(p, states);
+            for (qsizetype i = begin; i < end; ++i)
+                *boundingRect |= (markNode->placementTransform(markers.at(i)) * xf).mapRect(localBounds);
+            p->setTransform(xf);
+        } else if (!markNode->drawSprites(p, states, markers, begin, end)) {
+            p->save();
+            for (qsizetype i = begin; i < end; ++i) {
+                p->setTransform(markNode->placementTransform(markers.at(i)) * xf);
+                markNode->draw(p, states);
+            }
+            p->restore();
         }
 
         markNode->m_rect = oldRect;
-        p->restore();
+        begin = end;
+    }
+}
+
+QTransform QSvgMarker::placementTransform(const QSvgMarkerPlacement &placement) const
+{
+    QTransform transform = QTransform::fromTranslate(placement.position.x(), placement.position.y());
+    if (m_orientation == Orientation::Value) {
+        transform.rotate(m_orientationAngle);
+    } else {
+        transform.rotate(-placement.angle);
+        if (placement.isStartNode && m_orientation == Orientation::AutoStartReverse)
+            transform.scale(-1, -1);
+    }
+    return transform;
+}
+
+// With image-rendering="optimizeSpeed", a marker repeated along a shape is rendered
+// into a sprite per scale and subpixel phase, which is kept in the document and blitted
+// at each unrotated vertex. Rotated vertices are drawn directly, as a transformed blit
+// would not be filtered. Returns false if the markers need to be drawn directly.
+bool QSvgMarker::drawSprites(QPainter *p, QSvgExtraStates &states,
+                             const QList<QSvgMarkerPlacement> &placements,
+                             qsizetype begin, qsizetype end)
+{
+    // Up to 16 sprites are rendered for a run, so short runs are cheaper to draw directly
+    constexpr qsizetype minSpriteRun = 64;
+    if (end - begin < minSpriteRun
+        || states.imageRendering != QSvgQualityStyle::ImageRenderingOptimizeSpeed) {
+        return false;
+    }
+
+    QSvgTinyDocument *doc = document();
+    const QPaintDevice *device = p->device();
+    const bool hasViewTransform = p->viewTransformEnabled() && p->window() != p->viewport();
+    if (!doc || !device || !p->paintEngine() || p->paintEngine()->type() != QPaintEngine::Raster
+        || device->devicePixelRatio() != 1 || hasViewTransform
+        || p->compositionMode() != QPainter::CompositionMode_SourceOver) {
+        return false;
+    }
+
+    // Changes to the marker itself or to content referenced through <use> cannot be tracked
+    const QSharedPointer<QSvgAnimator> animator = doc->animated() ? doc->animator() : nullptr;
+    if (animator && (!animator->animationsForNode(this).isEmpty() || containsUse(this)))
+        return false;
+    const quint64 frame = animator ? animator->frame() : 0;
+
+    const QTransform xf = p->transform();
+    const QTransform linear(xf.m11(), xf.m12(), xf.m21(), xf.m22(), 0, 0);
+    if (xf.isProjective() || !linear.isInvertible())
+        return false;
+    const QTransform inverseLinear = linear.inverted();
+
+    // Bounds of the marker content in the coordinate system of a vertex, including strokes
+    p->resetTransform();
+    p->save();
+    setPainterToRectAndAdjustment(p);
+    const QRectF localBounds = QSvgStructureNode::decoratedInternalBounds(p, states);
+    p->restore();
+    p->setTransform(xf);
+    constexpr int maxSpriteSize = 512;
+    const QRectF spriteBounds = linear.mapRect(localBounds);
+    if (spriteBounds.isEmpty() || spriteBounds.width() > maxSpriteSize
+        || spriteBounds.height() > maxSpriteSize) {
+        return false;
+    }
+
+    const size_t context = QSvgSprite::contextHash(p, states);
+    const qreal opacity = p->opacity();
+    for (qsizetype i = begin; i < end; ++i) {
+        const QTransform vertex = placementTransform(placements.at(i)) * xf;
+        const QTransform spriteTransform = inverseLinear * vertex;
+
+        auto same = [](qreal a, qreal b) { return qFuzzyIsNull(a - b); };
+        const bool translateOnly = same(spriteTransform.m11(), 1) && same(spriteTransform.m12(), 0)
+                && same(spriteTransform.m21(), 0) && same(spriteTransform.m22(), 1)
+                && qAbs(vertex.dx()) < 1e7 && qAbs(vertex.dy()) < 1e7;
+
+        QImage sprite;
+        QPoint position;
+        if (translateOnly) {
+            // Positions are rounded to a quarter device pixel
+            const int quarterX = qRound(vertex.dx() * 4);
+            const int quarterY = qRound(vertex.dy() * 4);
+            const QPoint phase(quarterX & 3, quarterY & 3);
+            position = QPoint((quarterX - phase.x()) / 4, (quarterY - phase.y()) / 4);
+
+            const QSvgSpriteKey key{ this, xf.m11(), xf.m12(), xf.m21(), xf.m22(), phase, context };
+            const QSvgSprite *cached = doc->sprite(key);
+            if (cached && cached->matches(p, states)
+                && !(animator && animator->subtreeChangedSince(this, cached->frame))) {
+                sprite = cached->image;
+            } else {
+                sprite = renderSprite(p, states, localBounds,
+                                      linear * QTransform::fromTranslate(phase.x() / 4.0, phase.y() / 4.0));
+                doc->cacheSprite(key, QSvgSprite::create(sprite, p, states, frame, sprite.isNull()));
+            }
+        }
+
+        if (sprite.isNull()) {
+            p->setTransform(vertex);
+            draw(p, states);
+        } else {
+            p->resetTransform();
+            p->setOpacity(1);
+            p->drawImage(position + sprite.offset(), sprite);
+            p->setOpacity(opacity);
+        }
+    }
+    p->setTransform(xf);
+    return true;
+}
+
+QImage QSvgMarker::renderSprite(QPainter *p, QSvgExtraStates &states, const QRectF &localBounds,
+                                const QTransform &transform)
+{
+    const QRect rect = transform.mapRect(localBounds).toAlignedRect().adjusted(-1, -1, 1, 1);
+
+    QImage sprite;
+    if (!QImageIOHandler::allocateImage(rect.size(), QImage::Format_ARGB32_Premultiplied, &sprite))
+        return QImage();
+    sprite.fill(Qt::transparent);
+    sprite.setOffset(rect.topLeft());
+    sprite.setDotsPerMeterX(qRound(p->device()->logicalDpiX() / 0.0254));
+    sprite.setDotsPerMeterY(qRound(p->device()->logicalDpiY() / 0.0254));
+
+    QPainter spritePainter(&sprite);
+    spritePainter.setPen(p->pen());
+    spritePainter.setBrush(p->brush());
+    spritePainter.setFont(p->font());
+    spritePainter.setOpacity(p->opacity());
+    spritePainter.setRenderHints(p->renderHints());
+    spritePainter.translate(-rect.topLeft());
+    spritePainter.setTransform(transform, true);
+    draw(&spritePainter, states);
+    return sprite;
+}
+
+QList<QRectF> QSvgFilterContainer::regionsOfInterest(QPainter *p, const QRectF &bounds,
+                                                     const QRectF &localFilterRegion,
+                                                     const QRect &globalFilterRegion,
+                                                     const QRectF &targetRegion,
+                                                     QRect *sourceRegion) const
+{
+    // Resolve which primitive produces each of the inputs, following the same
+    // lookup rules as applyFilter(). The source graphic is denoted by -1.
+    constexpr qsizetype SourceIndex = -1;
+    const QList<QSvgNode *> children = renderers();
+
+    QHash<QString, qsizetype> producers;
+    producers[QStringLiteral("")] = SourceIndex;
+    producers[QStringLiteral("SourceGraphic")] = SourceIndex;
+    producers[QStringLiteral("SourceAlpha")] = SourceIndex;
+
+    QList<QList<qsizetype>> inputProducers(children.size());
+    qsizetype lastIndex = SourceIndex;
+    for (qsizetype i = 0; i < children.size(); ++i) {
+        const QSvgFeFilterPrimitive *filter = QSvgFeFilterPrimitive::castToFilterPrimitive(children.at(i));
+        if (!filter)
+            continue;
+        const QStringList inputs = filter->inputs();
+        for (const QString &input : inputs) {
+            const auto it = producers.constFind(input);
+            if (it != producers.cend())
+                inputProducers[i].append(it.value());
+        }
+        producers[QStringLiteral("")] = i;
+        producers[filter->result()] = i;
+        lastIndex = i;
+    }
+
+    // Walk the graph backwards, growing the region of interest of each primitive
+    // by whatever its consumers need in order to produce their own output.
+    QList<QRectF> regions(children.size());
+    QRectF sourceRect;
+    if (lastIndex != SourceIndex)
+        regions[lastIndex] = targetRegion.intersected(globalFilterRegion);
+
+    for (qsizetype i = lastIndex; i >= 0; --i) {
+        const QSvgFeFilterPrimitive *filter = QSvgFeFilterPrimitive::castToFilterPrimitive(children.at(i));
+        if (!filter || regions.at(i).isEmpty())
+            continue;
+
+        const QRectF outputRegion = regions.at(i).intersected(
+                filter->globalSubRegion(p, bounds, localFilterRegion, m_primitiveUnits, m_filterUnits));
+        if (outputRegion.isEmpty())
+            continue;
+
+        const QRectF inputRegion = filter->requiredInputRegion(p, outputRegion, bounds, localFilterRegion,
+                                                               m_primitiveUnits, m_filterUnits);
+        if (inputRegion.isEmpty())
+            continue;
+
+        const QRectF alignedInputRegion = inputRegion.toAlignedRect();
+        for (qsizetype producer : inputProducers.at(i)) {
+            if (producer == SourceIndex)
+                sourceRect = sourceRect.united(alignedInputRegion);
+            else
+                regions[producer] = regions.at(producer).united(alignedInputRegion);
+        }
     }
+
+    if (sourceRegion)
+        *sourceRegion = globalFilterRegion.intersected(sourceRect.toAlignedRect());
+    return regions;
 }
 
-QImage QSvgFilterContainer::applyFilter(const QImage &buffer, QPainter *p, const QRectF &bounds) const
+QImage QSvgFilterContainer::applyFilter(const QImage &buffer, QPainter *p, const QRectF &bounds,
+                                        const QRectF &targetRegion) const
 {
     QRectF localFilterRegion = m_rect.resolveRelativeLengths(bounds, m_filterUnits);
     QRect globalFilterRegion = p->transform().mapRect(localFilterRegion).toRect();
@@ -460,53 +662,213 @@ QImage QSvgFilterContainer::applyFilter(const QImage &buffer, QPainter *p, const
     if (globalFilterRegionRel.isEmpty())
         return buffer;
 
-    QImage proxy;
-    if (!QImageIOHandler::allocateImage(globalFilterRegionRel.size(), buffer.format(), &proxy)) {
-        qCWarning(lcSvgDraw) << "The requested filter is too big, ignoring";
-        return buffer;
-    }
-    proxy = buffer.copy(globalFilterRegionRel);
-    proxy.setOffset(globalFilterRegion.topLeft());
-    if (proxy.isNull())
-        return buffer;
+    // Only the parts of the intermediate results that end up in the target
+    // region are computed. Without a target, the whole filter region is used.
+    QRect globalSourceRegion;
+    const QList<QRectF> regions = regionsOfInterest(p, bounds, localFilterRegion, globalFilterRegion,
+                                                    targetRegion.isNull() ? QRectF(globalFilterRegion)
+                                                                          : targetRegion,
+                                                    &globalSourceRegion);
+
+    // With high precision filters, the chain runs on floating point buffers in its working
+    // color space, and converts from and to the 8 bit sRGB buffers only at its boundaries.
+    const bool highPrecision = isHighPrecision();
+    const bool linearLight = usesLinearLight();
+    static const QColorTransform toLinear = QColorSpace(QColorSpace::SRgb)
+            .transformationToColorSpace(QColorSpace::SRgbLinear);
+    static const QColorTransform fromLinear = QColorSpace(QColorSpace::SRgbLinear)
+            .transformationToColorSpace(QColorSpace::SRgb);
 
     QMap<QString, QImage> buffers;
-    buffers[QStringLiteral("")] = proxy;
-    buffers[QStringLiteral("SourceGraphic")] = proxy;
+    const QList<QSvgNode *> children = renderers();
 
-    bool requiresSourceAlpha = false;
+    if (!globalSourceRegion.isEmpty()) {
+        QRect globalSourceRegionRel = globalSourceRegion.translated(-buffer.offset());
+        QImage proxy;
+        if (!QImageIOHandler::allocateImage(globalSourceRegionRel.size(), buffer.format(), &proxy)) {
+            qCWarning(lcSvgDraw) << "The requested filter is too big, ignoring";
+            return buffer;
+        }
+        proxy = buffer.copy(globalSourceRegionRel);
+        if (proxy.isNull())
+            return buffer;
+        if (highPrecision) {
+            proxy.convertTo(QImage::Format_RGBA32FPx4_Premultiplied);
+            if (proxy.isNull())
+                return buffer;
+            if (linearLight)
+                proxy.applyColorTransform(toLinear);
+        }
+        proxy.setOffset(globalSourceRegion.topLeft());
 
-    const QList<QSvgNode *> children = renderers();
-    for (const QSvgNode *renderer : children) {
-        const QSvgFeFilterPrimitive *filter = QSvgFeFilterPrimitive::castToFilterPrimitive(renderer);
-        if (filter && filter->requiresSourceAlpha()) {
-            requiresSourceAlpha = true;
-            break;
+        buffers[QStringLiteral("")] = proxy;
+        buffers[QStringLiteral("SourceGraphic")] = proxy;
+
+        bool requiresSourceAlpha = false;
+
+        for (const QSvgNode *renderer : children) {
+            const QSvgFeFilterPrimitive *filter = QSvgFeFilterPrimitive::castToFilterPrimitive(renderer);
+            if (filter && filter->requiresSourceAlpha()) {
+                requiresSourceAlpha = true;
+                break;
+            }
         }
-    }
 
-    if (requiresSourceAlpha) {
-        QImage proxyAlpha = proxy.convertedTo(QImage::Format_Alpha8).convertedTo(proxy.format());
-        proxyAlpha.setOffset(proxy.offset());
-        if (proxyAlpha.isNull())
-            return buffer;
-        buffers[QStringLiteral("SourceAlpha")] = proxyAlpha;
+        if (requiresSourceAlpha) {
+            QImage proxyAlpha;
+            if (highPrecision) {
+                // Keep the full precision of the alpha channel
+                proxyAlpha = proxy.copy();
+                for (int y = 0; y < proxyAlpha.height(); ++y) {
+                    QRgbaFloat32 *line = reinterpret_cast<QRgbaFloat32 *>(proxyAlpha.scanLine(y));
+                    for (int x = 0; x < proxyAlpha.width(); ++x)
+                        line[x] = QRgbaFloat32{0, 0, 0, line[x].a};
+                }
+            } else {
+                proxyAlpha = proxy.convertedTo(QImage::Format_Alpha8).convertedTo(proxy.format());
+            }
+            proxyAlpha.setOffset(proxy.offset());
+            if (proxyAlpha.isNull())
+                return buffer;
+            buffers[QStringLiteral("SourceAlpha")] = proxyAlpha;
+        }
     }
 
     QImage result;
-    for (const QSvgNode *renderer : children) {
-        const QSvgFeFilterPrimitive *filter = QSvgFeFilterPrimitive::castToFilterPrimitive(renderer);
-        if (filter) {
-            result = filter->apply(buffers, p, bounds, localFilterRegion, m_primitiveUnits, m_filterUnits);
+    for (qsizetype i = 0; i < children.size(); ++i) {
+        const QSvgFeFilterPrimitive *filter = QSvgFeFilterPrimitive::castToFilterPrimitive(children.at(i));
+        // Primitives whose output is not needed anywhere are skipped entirely
+        if (filter && !regions.at(i).isEmpty()) {
+            result = filter->apply(buffers, p, bounds, localFilterRegion, m_primitiveUnits, m_filterUnits,
+                                   regions.at(i));
+            // A primitive whose subregion misses its region of interest produces nothing.
+            // Its consumers were resolved against it in regionsOfInterest(), so they must
+            // see a transparent input rather than the buffer of an earlier primitive.
+            if (result.isNull()) {
+                const QRect emptyRect = regions.at(i).toAlignedRect().intersected(globalFilterRegion);
+                if (!emptyRect.isEmpty()
+                    && QImageIOHandler::allocateImage(emptyRect.size(), bufferFormat(), &result)) {
+                    result.fill(Qt::transparent);
+                    result.setOffset(emptyRect.topLeft());
+                }
+            }
             if (!result.isNull()) {
                 buffers[QStringLiteral("")] = result;
                 buffers[filter->result()] = result;
             }
         }
     }
+
+    if (highPrecision && !result.isNull()) {
+        const QPoint offset = result.offset();
+        if (linearLight)
+            result.applyColorTransform(fromLinear);
+        result.convertTo(QImage::Format_ARGB32_Premultiplied);
+        result.setOffset(offset);
+    }
     return result;
 }
 
+QRect QSvgFilterContainer::sourceRegion(QPainter *p, const QRectF &bounds, const QRectF &targetRegion) const
+{
+    QRectF localFilterRegion = m_rect.resolveRelativeLengths(bounds, m_filterUnits);
+    QRect globalFilterRegion = p->transform().mapRect(localFilterRegion).toRect();
+
+    QRect globalSourceRegion;
+    regionsOfInterest(p, bounds, localFilterRegion, globalFilterRegion,
+                      targetRegion.isNull() ? QRectF(globalFilterRegion) : targetRegion,
+                      &globalSourceRegion);
+    return globalSourceRegion;
+}
+
+bool QSvgFilterContainer::isHighPrecision() const
+{
+    const QSvgTinyDocument *doc = document();
+    return doc && doc->options().testFlag(QtSvg::HighPrecisionFilters);
+}
+
+QImage::Format QSvgFilterContainer::bufferFormat() const
+{
+    return isHighPrecision() ? QImage::Format_RGBA32FPx4_Premultiplied
+                             : QImage::Format_ARGB32_Premultiplied;
+}
+
+bool QSvgFilterContainer::usesLinearLight() const
+{
+    // linearRGB is the initial value of color-interpolation-filters. It is only honored
+    // with floating point buffers, since converting 8 bit buffers would cause banding.
+    return isHighPrecision() && m_colorInterpolation != ColorInterpolation::SRgb;
+}
+
+static QSvgFilterResultKey filterResultKey(const QSvgNode *node, const QTransform &xf)
+{
+    return { node, xf.m11(), xf.m12(), xf.m21(), xf.m22() };
+}
+
+// Returns the result of filtering node in a previous frame of an animation, if neither
+// node nor the state it was drawn with have changed, apart from a translation by whole
+// device pixels. position receives the device position to draw the result at.
+QImage QSvgFilterContainer::cachedResult(const QSvgNode *node, QPainter *p, const QSvgExtraStates &states,
+                                         const QRectF &targetRegion, QPointF *position) const
+{
+    QSvgTinyDocument *doc = document();
+    if (!doc || !doc->animated())
+        return QImage();
+
+    const QTransform &xf = p->transform();
+    if (xf.isProjective())
+        return QImage();
+    QSvgFilterResult *cached = doc->filterResult(filterResultKey(node, xf));
+    if (!cached)
+        return QImage();
+
+    const QSharedPointer<QSvgAnimator> animator = doc->animator();
+    if (animator->subtreeChangedSince(node, cached->frame))
+        return QImage();
+    if (p->pen() != cached->pen || p->brush() != cached->brush || p->font() != cached->font
+        || p->renderHints() != cached->renderHints || QSvgInheritedStates(states) != cached->states) {
+        return QImage();
+    }
+
+    // Everything that is visible now must have been visible when the result was made
+    const QPointF delta = QPointF(xf.dx(), xf.dy()) - cached->translation;
+    if (!cached->targetRegion.isNull()
+        && (targetRegion.isNull() || !cached->targetRegion.contains(targetRegion.translated(-delta)))) {
+        return QImage();
+    }
+
+    // The result can only be moved by whole device pixels. A fractional move would
+    // resample it and blur it, so the filter is run again instead.
+    const qreal dpr = p->device()->devicePixelRatio();
+    const QPointF deviceDelta = delta * dpr;
+    const QPoint pixelDelta = deviceDelta.toPoint();
+    if (!qFuzzyIsNull(deviceDelta.x() - pixelDelta.x()) || !qFuzzyIsNull(deviceDelta.y() - pixelDelta.y()))
+        return QImage();
+
+    // Nothing changed up to this frame
+    cached->frame = animator->frame();
+    *position = QPointF(cached->image.offset()) + QPointF(pixelDelta) / dpr;
+    return cached->image;
+}
+
+void QSvgFilterContainer::cacheResult(const QSvgNode *node, QPainter *p, const QSvgExtraStates &states,
+                                      const QRectF &targetRegion, const QImage &result) const
+{
+    QSvgTinyDocument *doc = document();
+    if (!doc || !doc->animated() || result.isNull() || p->transform().isProjective())
+        return;
+    // Changes to content referenced through <use> cannot be tracked
+    if (containsUse(node))
+        return;
+
+    const QTransform &xf = p->transform();
+    doc->cacheFilterResult(filterResultKey(node, xf),
+                           new QSvgFilterResult{ result, QPointF(xf.dx(), xf.dy()), targetRegion,
+                                                 p->pen(), p->brush(), p->font(), p->renderHints(),
+                                                 QSvgInheritedStates(states),
+                                                 doc->animator()->frame() });
+}
+
 void QSvgFilterContainer::setSupported(bool supported)
 {
     m_supported = supported;
@@ -671,6 +1033,23 @@ QRectF QSvgStructureNode::decoratedInternalBounds(QPainter *p, QSvgExtraStates &
     return bounds;
 }
 
+// Returns true if drawing node draws content referenced through <use>, whose
+// changes cannot be tracked from node
+bool QSvgStructureNode::containsUse(const QSvgNode *node)
+{
+    if (node->type() == QSvgNode::Use)
+        return true;
+    if (node->type() == QSvgNode::Group || node->type() == QSvgNode::Switch
+        || node->type() == QSvgNode::Symbol || node->type() == QSvgNode::Marker) {
+        const QList<QSvgNode *> children = static_cast<const QSvgStructureNode *>(node)->renderers();
+        for (const QSvgNode *child : children) {
+            if (containsUse(child))
+                return true;
+        }
+    }
+    return false;
+}
+
 QSvgNode* QSvgStructureNode::previousSiblingNode(QSvgNode *n) const
 {
     QSvgNode *prev = nullptr;
@@ -684,6 +1063,134 @@ QSvgNode* QSvgStructureNode::previousSiblingNode(QSvgNode *n) const
     return prev;
 }
 
+// Adds the area covered by node, in the coordinate system of the painter's device, to
+// shapes. Returns false if the area cannot be determined geometrically, as for text,
+// images or nested clip paths, or, with opaqueWhiteOnly, if node is not filled with
+// opaque white and nothing else.
+static bool appendShape(QSvgNode *node, QPainter *p, QSvgExtraStates &states,
+                        bool opaqueWhiteOnly, QPainterPath *shapes, int depth = 0)
+{
+    if (!node->isVisible() || node->displayMode() == QSvgNode::NoneMode)
+        return true;
+    if (depth > 16 || node->hasClipPath())
+        return false;
+    if (opaqueWhiteOnly && (node->hasMask() || node->hasFilter()))
+        return false;
+    if (opaqueWhiteOnly && node->document()->animated()
+        && !node->document()->animator()->animationsForNode(node).isEmpty()) {
+        return false;
+    }
+
+    bool ok = true;
+    const QTransform worldTransform = p->worldTransform();
+    node->applyStyle(p, states);
+    if (node->document()->animated())
+        node->document()->animator()->applyAnimationsOnNode(node, p);
+
+    QPainterPath shape;
+    switch (node->type()) {
+    case QSvgNode::Rect: {
+        const QSvgRect *rect = static_cast<const QSvgRect *>(node);
+        const QPointF radius = rect->radius();
+        if (radius.x() || radius.y())
+            shape.addRoundedRect(rect->rect(), radius.x(), radius.y(), Qt::RelativeSize);
+        else
+            shape.addRect(rect->rect());
+        break;
+    }
+    case QSvgNode::Circle:
+    case QSvgNode::Ellipse:
+        shape.addEllipse(static_cast<const QSvgEllipse *>(node)->rect());
+        break;
+    case QSvgNode::Path:
+        shape = static_cast<const QSvgPath *>(node)->path();
+        break;
+    case QSvgNode::Polygon:
+        shape.addPolygon(static_cast<const QSvgPolygon *>(node)->polygon());
+        shape.closeSubpath();
+        break;
+    case QSvgNode::Polyline:
+        shape.addPolygon(static_cast<const QSvgPolyline *>(node)->polygon());
+        break;
+    case QSvgNode::Line:
+        break;
+    case QSvgNode::Group:
+        for (QSvgNode *child : static_cast<const QSvgStructureNode *>(node)->renderers()) {
+            ok = appendShape(child, p, states, opaqueWhiteOnly, shapes, depth + 1);
+            if (!ok)
+                break;
+        }
+        break;
+    case QSvgNode::Use: {
+        const QSvgUse *use = static_cast<const QSvgUse *>(node);
+        if (use->link() && !use->isDescendantOf(use->link())) {
+            const QTransform xf = p->worldTransform();
+            p->translate(use->start());
+            ok = appendShape(use->link(), p, states, opaqueWhiteOnly, shapes, depth + 1);
+            p->setWorldTransform(xf);
+        }
+        break;
+    }
+    default:
+        ok = false;
+        break;
+    }
+
+    if (ok && !shape.isEmpty()) {
+        if (opaqueWhiteOnly) {
+            const QPen &pen = p->pen();
+            const bool stroked = pen.style() != Qt::NoPen && pen.brush().style() != Qt::NoBrush
+                    && pen.widthF() != 0;
+            const QBrush &brush = p->brush();
+            const bool filled = brush.style() != Qt::NoBrush;
+            if (stroked || (filled && (brush.style() != Qt::SolidPattern
+                                       || brush.color().rgba() != qRgba(255, 255, 255, 255)
+                                       || states.fillOpacity < 1 || p->opacity() < 1))) {
+                ok = false;
+            }
+            if (!filled)
+                shape.clear();
+        }
+    }
+    if (ok && !shape.isEmpty()) {
+        shape.setFillRule(states.fillRule);
+        shape = p->worldTransform().map(shape);
+        *shapes = shapes->isEmpty() ? shape : shapes->united(shape);
+    }
+
+    node->revertStyle(p, states);
+    p->setWorldTransform(worldTransform);
+    return ok;
+}
+
+// Computes the union of the areas covered by the children, in the coordinate system they
+// are drawn in, without the transform of this node. Returns false if the area of any
+// child cannot be determined, or, with opaqueWhiteOnly, if any child is anything but an
+// opaque white fill.
+bool QSvgStructureNode::childShapes(bool opaqueWhiteOnly, QPainterPath *shapes) const
+{
+    QImage dummy(1, 1, QImage::Format_RGB32);
+    QPainter p(&dummy);
+    initPainter(&p);
+    QSvgExtraStates states;
+    applyStyleRecursive(&p, states);
+    p.setWorldTransform(QTransform());
+
+    QPainterPath result;
+    bool ok = true;
+    for (QSvgNode *child : m_renderers) {
+        if (!appendShape(child, &p, states, opaqueWhiteOnly, &result)) {
+            ok = false;
+            break;
+        }
+    }
+
+    revertStyleRecursive(&p, states);
+    if (ok)
+        *shapes = result;
+    return ok;
+}
+
 QSvgMask::QSvgMask(QSvgNode *parent, QSvgRectF bounds,
                    QtSvg::UnitTypes contentUnits)
     : QSvgStructureNode(parent)
@@ -712,8 +1219,11 @@ QImage QSvgMask::createMask(QPainter *p, QSvgExtraStates &states, const QRectF &
     QRect imageBound = globalRect->toAlignedRect();
     *globalRect = imageBound.toRectF();
 
+    // Gray content is rendered into a single channel buffer, a quarter of the size
+    const QImage::Format format = isGrayscale() ? QImage::Format_Grayscale8
+                                                : QImage::Format_ARGB32_Premultiplied;
     QImage mask;
-    if (!QImageIOHandler::allocateImage(imageBound.size(), QImage::Format_RGBA8888, &mask)) {
+    if (!QImageIOHandler::allocateImage(imageBound.size(), format, &mask)) {
         qCWarning(lcSvgDraw) << "The requested mask size is too big, ignoring";
         return mask;
     }
@@ -733,9 +1243,9 @@ QImage QSvgMask::createMask(QPainter *p, QSvgExtraStates &states, const QRectF &
 
     // The mask is created with other elements during rendering.
     // Black pixels are masked out, white pixels are not masked.
-    // The strategy is to draw the elements in a buffer (QImage) and to map
-    // the white-black image into a transparent-white image that can be used
-    // with QPainters composition mode to set the mask.
+    // The strategy is to draw the elements in a premultiplied buffer (QImage), or
+    // in a grayscale buffer starting out black, which holds the luminance directly.
+    // QSvgNode::applyMaskToBuffer() maps it to luminance while applying it.
 
     mask.fill(Qt::transparent);
     QPainter painter(&mask);
@@ -765,16 +1275,7 @@ QImage QSvgMask::createMask(QPainter *p, QSvgExtraStates &states, const QRectF &
         ++itr;
     }
 
-    for (int i=0; i < mask.height(); i++) {
-        QRgb *line = reinterpret_cast<QRgb *>(mask.scanLine(i));
-        for (int j=0; j < mask.width(); j++) {
-            const qreal rC = 0.2125, gC = 0.7154, bC = 0.0721; //luminanceToAlpha times alpha following SVG 1.1
-            int alpha = 255 - (qRed(line[j]) * rC + qGreen(line[j]) * gC + qBlue(line[j]) * bC) * qAlpha(line[j])/255.;
-            line[j] = qRgba(0, 0, 0, alpha);
-        }
-    }
-
-    // Make a path out of the clipRectangle and draw it inverted - black over all content items.
+    // Make a path out of the clipRectangle and clear everything outside of it.
     // This is required to apply a clip rectangle with transformations.
     // painter.setClipRect(clipRect) sounds like the obvious thing to do but
     // created artifacts due to antialiasing.
@@ -784,6 +1285,7 @@ QImage QSvgMask::createMask(QPainter *p, QSvgExtraStates &states, const QRectF &
     clipPath.addRect(mask.rect().adjusted(-10, -10, 20, 20));
     clipPath.addPolygon(oldT.map(QPolygonF(clipRect)));
     painter.resetTransform();
+    painter.setCompositionMode(QPainter::CompositionMode_Clear);
     painter.fillPath(clipPath, Qt::black);
     revertStyleRecursive(&painter, maskNodeStates);
     return mask;
@@ -794,13 +1296,201 @@ QSvgNode::Type QSvgMask::type() const
     return Mask;
 }
 
+// A mask whose content consists only of opaque white fills has a luminance of either
+// 0 or 1 everywhere. It can be applied as a vector clip, without any offscreen buffers.
+bool QSvgMask::isBinary() const
+{
+    if (m_binary == ContentKind::Unknown) {
+        const bool binary = !hasMask() && childShapes(true, &m_shapes);
+        m_binary = binary ? ContentKind::Yes : ContentKind::No;
+    }
+    return m_binary == ContentKind::Yes;
+}
+
+static bool isGrayBrush(const QBrush &brush)
+{
+    auto isGray = [](const QColor &color) {
+        const QRgb rgb = color.rgb();
+        return qRed(rgb) == qGreen(rgb) && qGreen(rgb) == qBlue(rgb);
+    };
+
+    switch (brush.style()) {
+    case Qt::NoBrush:
+        return true;
+    case Qt::SolidPattern:
+        return isGray(brush.color());
+    case Qt::LinearGradientPattern:
+    case Qt::RadialGradientPattern:
+    case Qt::ConicalGradientPattern:
+        for (const QGradientStop &stop : brush.gradient()->stops()) {
+            if (!isGray(stop.second))
+                return false;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isGrayscaleContent(QSvgNode *node, QPainter *p, QSvgExtraStates &states, int depth = 0)
+{
+    if (!node->isVisible() || node->displayMode() == QSvgNode::NoneMode)
+        return true;
+    if (depth > 16 || node->hasFilter() || node->hasAnyMarker())
+        return false;
+    if (node->document()->animated() && !node->document()->animator()->animationsForNode(node).isEmpty())
+        return false;
+
+    node->applyStyle(p, states);
+    bool ok = isGrayBrush(p->brush()) && (p->pen().style() == Qt::NoPen || isGrayBrush(p->pen().brush()));
+    if (ok) {
+        switch (node->type()) {
+        case QSvgNode::Rect:
+        case QSvgNode::Circle:
+        case QSvgNode::Ellipse:
+        case QSvgNode::Path:
+        case QSvgNode::Polygon:
+        case QSvgNode::Polyline:
+        case QSvgNode::Line:
+            break;
+        case QSvgNode::Group:
+            for (QSvgNode *child : static_cast<const QSvgStructureNode *>(node)->renderers()) {
+                ok = isGrayscaleContent(child, p, states, depth + 1);
+                if (!ok)
+                    break;
+            }
+            break;
+        case QSvgNode::Use: {
+            const QSvgUse *use = static_cast<const QSvgUse *>(node);
+            if (use->link() && !use->isDescendantOf(use->link()))
+                ok = isGrayscaleContent(use->link(), p, states, depth + 1);
+            break;
+        }
+        default:
+            ok = false;
+            break;
+        }
+    }
+    node->revertStyle(p, states);
+    return ok;
+}
+
+// A mask whose content only uses gray colors has the same value in all color channels.
+// It can be rendered into a single channel buffer, where compositing over black yields
+// the luminance multiplied by the alpha of the content directly.
+bool QSvgMask::isGrayscale() const
+{
+    if (m_grayscale == ContentKind::Unknown) {
+        QImage dummy(1, 1, QImage::Format_RGB32);
+        QPainter p(&dummy);
+        initPainter(&p);
+        QSvgExtraStates states;
+        applyStyleRecursive(&p, states);
+
+        bool grayscale = true;
+        for (QSvgNode *child : m_renderers) {
+            if (!isGrayscaleContent(child, &p, states)) {
+                grayscale = false;
+                break;
+            }
+        }
+        revertStyleRecursive(&p, states);
+        m_grayscale = grayscale ? ContentKind::Yes : ContentKind::No;
+    }
+    return m_grayscale == ContentKind::Yes;
+}
+
+// Returns the area a binary mask lets through, in the user space of targetNode
+QPainterPath QSvgMask::clipPath(QPainter *p, QSvgExtraStates &states, const QSvgNode *targetNode) const
+{
+    Q_ASSERT(isBinary());
+    QTransform xf = p->transform();
+    p->resetTransform();
+    const QRectF localRect = targetNode->internalBounds(p, states);
+    p->setTransform(xf);
+
+    QPainterPath shapes = m_shapes;
+    if (m_contentUnits == QtSvg::UnitTypes::objectBoundingBox) {
+        shapes = QTransform(localRect.width(), 0, 0, localRect.height(),
+                            localRect.x(), localRect.y()).map(shapes);
+    }
+
+    const QRectF maskRect = m_rect.resolveRelativeLengths(localRect);
+    if (maskRect.contains(shapes.boundingRect()))
+        return shapes;
+    QPainterPath maskRectPath;
+    maskRectPath.addRect(maskRect);
+    return shapes.intersected(maskRectPath);
+}
+
+QSvgClipPath::QSvgClipPath(QSvgNode *parent, QtSvg::UnitTypes clipPathUnits)
+    : QSvgStructureNode(parent)
+    , m_clipPathUnits(clipPathUnits)
+{
+}
+
+bool QSvgClipPath::shouldDrawNode(QPainter *, QSvgExtraStates &) const
+{
+    return false;
+}
+
+QSvgNode::Type QSvgClipPath::type() const
+{
+    return ClipPath;
+}
+
+// Returns the clipping region in the user space of targetNode. ok is set to false if the
+// region cannot be determined, because the content has parts without a geometric outline.
+QPainterPath QSvgClipPath::clipPath(QPainter *p, QSvgExtraStates &states, const QSvgNode *targetNode,
+                                    bool *ok) const
+{
+    const QSvgTinyDocument *doc = document();
+    if (m_shapesValid && doc && doc->animated()) {
+        const QSharedPointer<QSvgAnimator> animator = doc->animator();
+        if (animator->subtreeChangedSince(this, m_shapesFrame))
+            m_shapesValid = false;
+        // Changes to content referenced through <use> cannot be tracked
+        for (const QSvgNode *node : std::as_const(m_renderers)) {
+            if (containsUse(node))
+                m_shapesValid = false;
+        }
+    }
+    if (!m_shapesValid) {
+        m_shapesSupported = childShapes(false, &m_shapes);
+        m_shapesValid = true;
+        if (doc && doc->animated())
+            m_shapesFrame = doc->animator()->frame();
+    }
+    *ok = m_shapesSupported;
+    if (!m_shapesSupported)
+        return QPainterPath();
+
+    QTransform contentTransform;
+    if (m_clipPathUnits == QtSvg::UnitTypes::objectBoundingBox) {
+        QTransform xf = p->transform();
+        p->resetTransform();
+        const QRectF localRect = targetNode->internalBounds(p, states);
+        p->setTransform(xf);
+        contentTransform = QTransform(localRect.width(), 0, 0, localRect.height(),
+                                      localRect.x(), localRect.y());
+    }
+    if (m_style.transform)
+        contentTransform *= m_style.transform->qtransform();
+
+    return contentTransform.isIdentity() ? m_shapes : contentTransform.map(m_shapes);
+}
+
+// The tile cache is limited per pattern, in kilobytes
+static constexpr qsizetype patternTileCacheBudget = 8 * 1024;
+
 QSvgPattern::QSvgPattern(QSvgNode *parent, QSvgRectF bounds, QRectF viewBox,
                          QtSvg::UnitTypes contentUnits, QTransform transform)
     : QSvgStructureNode(parent),
     m_rect(bounds),
     m_viewBox(viewBox),
     m_contentUnits(contentUnits),
-    m_transform(transform)
+    m_transform(transform),
+    m_tileCache(patternTileCacheBudget)
 
 {
 
@@ -816,7 +1506,7 @@ static QImage& defaultPattern()
     static QImage checkerPattern;
 
     if (checkerPattern.isNull()) {
-        checkerPattern = QImage(QSize(8, 8), QImage::Format_ARGB32);
+        checkerPattern = QImage(QSize(8, 8), QImage::Format_ARGB32_Premultiplied);
         QPainter p(&checkerPattern);
         p.fillRect(QRect(0, 0, 4, 4), QColorConstants::Svg::white);
         p.fillRect(QRect(4, 0, 4, 4), QColorConstants::Svg::black);
@@ -859,12 +1549,46 @@ QImage QSvgPattern::patternImage(QPainter *p, QSvgExtraStates &states, const QSv
     // Calculate the pattern bounding box depending on the used UnitTypes
     QRectF patternBoundingBox = m_rect.resolveRelativeLengths(peBoundingBox);
 
+    // Round sizes that are integral up to precision errors to the nearest integer, so that
+    // no scaling is needed when the tile is drawn, and it maps to device pixels 1:1.
+    auto tileExtent = [](qreal size) {
+        const qreal rounded = qRound(size);
+        return qAbs(size - rounded) < 1e-6 ? int(rounded) : qCeil(size);
+    };
     QSize imageSize;
-    imageSize.setWidth(qCeil(patternBoundingBox.width() * t.m11() * m_transform.m11()));
-    imageSize.setHeight(qCeil(patternBoundingBox.height() * t.m22() * m_transform.m22()));
+    imageSize.setWidth(tileExtent(patternBoundingBox.width() * t.m11() * m_transform.m11()));
+    imageSize.setHeight(tileExtent(patternBoundingBox.height() * t.m22() * m_transform.m22()));
 
     calculateAppliedTransform(t, peBoundingBox, imageSize);
-    return renderPattern(imageSize, contentScaleFactorX, contentScaleFactorY);
+    return cachedPattern(imageSize, contentScaleFactorX, contentScaleFactorY);
+}
+
+// Returns a tile rendered earlier with the same size and scale, unless an animation
+// has changed the content of the pattern since then.
+QImage QSvgPattern::cachedPattern(QSize size, qreal contentScaleX, qreal contentScaleY)
+{
+    const QSvgTinyDocument *doc = document();
+    if (doc && doc->animated()) {
+        // Changes to content referenced through <use> cannot be tracked
+        for (const QSvgNode *node : std::as_const(m_renderers)) {
+            if (containsUse(node))
+                return renderPattern(size, contentScaleX, contentScaleY);
+        }
+        const QSharedPointer<QSvgAnimator> animator = doc->animator();
+        if (animator->subtreeChangedSince(this, m_tileCacheFrame))
+            m_tileCache.clear();
+        m_tileCacheFrame = animator->frame();
+    }
+
+    const TileKey key = { size, contentScaleX, contentScaleY };
+    if (const QImage *tile = m_tileCache.object(key))
+        return *tile;
+
+    const QImage tile = renderPattern(size, contentScaleX, contentScaleY);
+    if (tile.cacheKey() != defaultPattern().cacheKey()) {
+        m_tileCache.insert(key, new QImage(tile), qMax(qsizetype(1), tile.sizeInBytes() / 1024));
+    }
+    return tile;
 }
 
 QSvgNode::Type QSvgPattern::type() const
@@ -877,9 +1601,10 @@ QImage QSvgPattern::renderPattern(QSize size, qreal contentScaleX, qreal content
     if (size.isEmpty() || !qIsFinite(contentScaleX) || !qIsFinite(contentScaleY))
         return defaultPattern();
 
-    // Allocate a QImage to draw the pattern in with the calculated size.
+    // Allocate a QImage to draw the pattern in with the calculated size. It is used as
+    // a brush texture, so use the format of the raster engine to avoid conversions.
     QImage pattern;
-    if (!QImageIOHandler::allocateImage(size, QImage::Format_ARGB32, &pattern)) {
+    if (!QImageIOHandler::allocateImage(size, QImage::Format_ARGB32_Premultiplied, &pattern)) {
         qCWarning(lcSvgDraw) << "The requested pattern size is too big, ignoring";
         return defaultPattern();
     }
@@ -19,6 +19,8 @@
 
 #include "QtCore/qlist.h"
 #include "QtCore/qhash.h"
+#include "QtCore/qcache.h"
+#include "QtGui/qpainterpath.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -38,7 +40,10 @@ public:
     QRectF decoratedInternalBounds(QPainter *p, QSvgExtraStates &states) const override;
     QSvgNode *previousSiblingNode(QSvgNode *n) const;
     QList<QSvgNode*> renderers() const { return m_renderers; }
+    static bool containsUse(const QSvgNode *node);
 protected:
+    bool childShapes(bool opaqueWhiteOnly, QPainterPath *shapes) const;
+
     QList<QSvgNode*>          m_renderers;
     QHash<QString, QSvgNode*> m_scope;
     QList<QSvgStructureNode*> m_linkedScopes;
@@ -120,6 +125,15 @@ public:
     Type type() const override;
 };
 
+// Position and orientation of a marker on a vertex of the shape it decorates
+struct QSvgMarkerPlacement
+{
+    QPointF position;
+    qreal angle = 0;
+    QString markerId;
+    bool isStartNode = false;
+};
+
 class Q_SVG_EXPORT QSvgMarker : public QSvgSymbolLike
 {
 public:
@@ -139,6 +153,7 @@ public:
     void drawCommand(QPainter *p, QSvgExtraStates &states) override;
     static void drawMarkersForNode(QSvgNode *node, QPainter *p, QSvgExtraStates &states);
     static QRectF markersBoundsForNode(const QSvgNode *node, QPainter *p, QSvgExtraStates &states);
+    static QList<QSvgMarkerPlacement> placementsForNode(const QSvgNode *node);
 
     Orientation orientation() const {
         return m_orientation;
@@ -154,6 +169,11 @@ public:
 private:
     static void drawHelper(const QSvgNode *node, QPainter *p,
                            QSvgExtraStates &states, QRectF *boundingRect = nullptr);
+    QTransform placementTransform(const QSvgMarkerPlacement &placement) const;
+    bool drawSprites(QPainter *p, QSvgExtraStates &states,
+                     const QList<QSvgMarkerPlacement> &placements, qsizetype begin, qsizetype end);
+    QImage renderSprite(QPainter *p, QSvgExtraStates &states, const QRectF &localBounds,
+                        const QTransform &transform);
 
     Orientation m_orientation;
     qreal m_orientationAngle;
@@ -163,19 +183,39 @@ private:
 class Q_SVG_EXPORT QSvgFilterContainer : public QSvgStructureNode
 {
 public:
+    enum class ColorInterpolation : quint8 {
+        Auto,
+        SRgb,
+        LinearRgb
+    };
 
-    QSvgFilterContainer(QSvgNode *parent, const QSvgRectF &bounds, QtSvg::UnitTypes filterUnits, QtSvg::UnitTypes primitiveUnits);
+    QSvgFilterContainer(QSvgNode *parent, const QSvgRectF &bounds, QtSvg::UnitTypes filterUnits, QtSvg::UnitTypes primitiveUnits,
+                        ColorInterpolation colorInterpolation = ColorInterpolation::Auto);
     void drawCommand(QPainter *, QSvgExtraStates &) override {};
     bool shouldDrawNode(QPainter *, QSvgExtraStates &) const override;
     Type type() const override;
-    QImage applyFilter(const QImage &buffer, QPainter *p, const QRectF &bounds) const;
+    QImage applyFilter(const QImage &buffer, QPainter *p, const QRectF &bounds,
+                       const QRectF &targetRegion = QRectF()) const;
+    QRect sourceRegion(QPainter *p, const QRectF &bounds, const QRectF &targetRegion = QRectF()) const;
     void setSupported(bool supported);
     bool supported() const;
     QRectF filterRegion(const QRectF &itemBounds) const;
+    bool isHighPrecision() const;
+    QImage::Format bufferFormat() const;
+    bool usesLinearLight() const;
+    QImage cachedResult(const QSvgNode *node, QPainter *p, const QSvgExtraStates &states,
+                        const QRectF &targetRegion, QPointF *position) const;
+    void cacheResult(const QSvgNode *node, QPainter *p, const QSvgExtraStates &states,
+                     const QRectF &targetRegion, const QImage &result) const;
 private:
+    QList<QRectF> regionsOfInterest(QPainter *p, const QRectF &bounds, const QRectF &localFilterRegion,
+                                    const QRect &globalFilterRegion, const QRectF &targetRegion,
+                                    QRect *sourceRegion) const;
+
     QSvgRectF m_rect;
     QtSvg::UnitTypes m_filterUnits;
     QtSvg::UnitTypes m_primitiveUnits;
+    ColorInterpolation m_colorInterpolation;
     bool m_supported;
 };
 
@@ -205,6 +245,9 @@ public:
     Type type() const override;
     QImage createMask(QPainter *p, QSvgExtraStates &states, QSvgNode *targetNode, QRectF *globalRect) const;
     QImage createMask(QPainter *p, QSvgExtraStates &states, const QRectF &localRect, QRectF *globalRect) const;
+    bool isBinary() const;
+    bool isGrayscale() const;
+    QPainterPath clipPath(QPainter *p, QSvgExtraStates &states, const QSvgNode *targetNode) const;
 
     QSvgRectF rect() const
     {
@@ -217,8 +260,40 @@ public:
     }
 
 private:
+    enum class ContentKind : quint8 {
+        Unknown,
+        Yes,
+        No
+    };
+
     QSvgRectF m_rect;
     QtSvg::UnitTypes m_contentUnits;
+    mutable ContentKind m_binary = ContentKind::Unknown;
+    mutable ContentKind m_grayscale = ContentKind::Unknown;
+    mutable QPainterPath m_shapes;
+};
+
+class Q_SVG_EXPORT QSvgClipPath : public QSvgStructureNode
+{
+public:
+    QSvgClipPath(QSvgNode *parent, QtSvg::UnitTypes clipPathUnits);
+    void drawCommand(QPainter *, QSvgExtraStates &) override {};
+    bool shouldDrawNode(QPainter *, QSvgExtraStates &) const override;
+    Type type() const override;
+    QPainterPath clipPath(QPainter *p, QSvgExtraStates &states, const QSvgNode *targetNode,
+                          bool *ok) const;
+
+    QtSvg::UnitTypes clipPathUnits() const
+    {
+        return m_clipPathUnits;
+    }
+
+private:
+    QtSvg::UnitTypes m_clipPathUnits;
+    mutable bool m_shapesValid = false;
+    mutable bool m_shapesSupported = false;
+    mutable quint64 m_shapesFrame = 0;
+    mutable QPainterPath m_shapes;
 };
 
 class Q_SVG_EXPORT QSvgPattern : public QSvgStructureNode
@@ -233,6 +308,23 @@ public:
     const QTransform& appliedTransform() const { return m_appliedTransform; }
 
 private:
+    struct TileKey {
+        QSize size;
+        qreal contentScaleX;
+        qreal contentScaleY;
+
+        friend bool operator==(const TileKey &a, const TileKey &b) noexcept
+        {
+            return a.size == b.size && a.contentScaleX == b.contentScaleX
+                    && a.contentScaleY == b.contentScaleY;
+        }
+        friend size_t qHash(const TileKey &key, size_t seed = 0) noexcept
+        {
+            return qHashMulti(seed, key.size, key.contentScaleX, key.contentScaleY);
+        }
+    };
+
+    QImage cachedPattern(QSize size, qreal contentScaleX, qreal contentScaleY);
     QImage renderPattern(QSize size, qreal contentScaleX, qreal contentScaleY);
     void calculateAppliedTransform(QTransform& worldTransform, QRectF peLocalBB, QSize imageSize);
 
@@ -242,6 +334,8 @@ private:
     QRectF m_viewBox;
     QtSvg::UnitTypes m_contentUnits;
     QTransform m_transform;
+    QCache<TileKey, QImage> m_tileCache;
+    quint64 m_tileCacheFrame = 0;
 };
 
 QT_END_NAMESPACE
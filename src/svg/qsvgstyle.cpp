@@ -30,24 +30,65 @@ QSvgExtraStates::QSvgExtraStates()
 {
 }
 
-QSvgStyleProperty::~QSvgStyleProperty()
+QSvgInheritedStates::QSvgInheritedStates(const QSvgExtraStates &states)
+    : fillOpacity(states.fillOpacity),
+      strokeOpacity(states.strokeOpacity),
+      svgFont(states.svgFont),
+      textAnchor(states.textAnchor),
+      fontWeight(states.fontWeight),
+      fillRule(states.fillRule),
+      strokeDashOffset(states.strokeDashOffset),
+      vectorEffect(states.vectorEffect),
+      imageRendering(states.imageRendering)
 {
 }
 
-void QSvgPaintStyleProperty::apply(QPainter *, const QSvgNode *, QSvgExtraStates &)
+void QSvgInheritedStates::restore(QSvgExtraStates &states) const
 {
-    Q_ASSERT(!"This should not be called!");
+    states.fillOpacity = fillOpacity;
+    states.strokeOpacity = strokeOpacity;
+    states.svgFont = svgFont;
+    states.textAnchor = textAnchor;
+    states.fontWeight = fontWeight;
+    states.fillRule = fillRule;
+    states.strokeDashOffset = strokeDashOffset;
+    states.vectorEffect = vectorEffect;
+    states.imageRendering = imageRendering;
 }
 
-void QSvgPaintStyleProperty::revert(QPainter *, QSvgExtraStates &)
+void QSvgExtraStates::setFont(QPainter *p, const QFont &font)
+{
+    if (p->font() == font) {
+        ++painterUpdatesElided;
+        return;
+    }
+    ++painterUpdatesIssued;
+    p->setFont(font);
+}
+
+void QSvgExtraStates::setWorldTransform(QPainter *p, const QTransform &transform)
+{
+    if (p->worldTransform() == transform) {
+        ++painterUpdatesElided;
+        return;
+    }
+    ++painterUpdatesIssued;
+    p->setWorldTransform(transform);
+}
+
+QSvgStyleProperty::~QSvgStyleProperty()
+{
+}
+
+void QSvgPaintStyleProperty::apply(QPainter *, const QSvgNode *, QSvgExtraStates &)
 {
     Q_ASSERT(!"This should not be called!");
 }
 
 
+
 QSvgQualityStyle::QSvgQualityStyle(int color)
     : m_imageRendering(QSvgQualityStyle::ImageRenderingAuto)
-    , m_oldImageRendering(QSvgQualityStyle::ImageRenderingAuto)
     , m_imageRenderingSet(0)
 {
     Q_UNUSED(color);
@@ -60,7 +101,6 @@ void QSvgQualityStyle::setImageRendering(ImageRendering hint) {
 
 void QSvgQualityStyle::apply(QPainter *p, const QSvgNode *, QSvgExtraStates &states)
 {
-   m_oldImageRendering = states.imageRendering;
    if (m_imageRenderingSet) {
        states.imageRendering = m_imageRendering;
    }
@@ -75,25 +115,10 @@ void QSvgQualityStyle::apply(QPainter *p, const QSvgNode *, QSvgExtraStates &sta
    }
 }
 
-void QSvgQualityStyle::revert(QPainter *p, QSvgExtraStates &states)
-{
-    if (m_imageRenderingSet) {
-        states.imageRendering = m_oldImageRendering;
-        bool smooth = false;
-        if (m_oldImageRendering == ImageRenderingAuto)
-            smooth = true;
-        else
-            smooth = (m_oldImageRendering == ImageRenderingOptimizeQuality);
-        p->setRenderHint(QPainter::SmoothPixmapTransform, smooth);
-    }
-}
-
 QSvgFillStyle::QSvgFillStyle()
     : m_style(0)
     , m_fillRule(Qt::WindingFill)
-    , m_oldFillRule(Qt::WindingFill)
     , m_fillOpacity(1.0)
-    , m_oldFillOpacity(0)
     , m_paintStyleResolved(1)
     , m_fillRuleSet(0)
     , m_fillOpacitySet(0)
@@ -128,10 +153,6 @@ void QSvgFillStyle::setBrush(QBrush brush)
 
 void QSvgFillStyle::apply(QPainter *p, const QSvgNode *n, QSvgExtraStates &states)
 {
-    m_oldFill = p->brush();
-    m_oldFillRule = states.fillRule;
-    m_oldFillOpacity = states.fillOpacity;
-
     if (m_fillRuleSet)
         states.fillRule = m_fillRule;
     if (m_fillSet) {
@@ -144,16 +165,6 @@ void QSvgFillStyle::apply(QPainter *p, const QSvgNode *n, QSvgExtraStates &state
         states.fillOpacity = m_fillOpacity;
 }
 
-void QSvgFillStyle::revert(QPainter *p, QSvgExtraStates &states)
-{
-    if (m_fillOpacitySet)
-        states.fillOpacity = m_oldFillOpacity;
-    if (m_fillSet)
-        p->setBrush(m_oldFill);
-    if (m_fillRuleSet)
-        states.fillRule = m_oldFillRule;
-}
-
 QSvgViewportFillStyle::QSvgViewportFillStyle(const QBrush &brush)
     : m_viewportFill(brush)
 {
@@ -161,15 +172,9 @@ QSvgViewportFillStyle::QSvgViewportFillStyle(const QBrush &brush)
 
 void QSvgViewportFillStyle::apply(QPainter *p, const QSvgNode *, QSvgExtraStates &)
 {
-    m_oldFill = p->brush();
     p->setBrush(m_viewportFill);
 }
 
-void QSvgViewportFillStyle::revert(QPainter *p, QSvgExtraStates &)
-{
-    p->setBrush(m_oldFill);
-}
-
 QSvgFontStyle::QSvgFontStyle(QSvgFont *font, QSvgTinyDocument *doc)
     : m_svgFont(font)
     , m_doc(doc)
@@ -196,15 +201,10 @@ QSvgFontStyle::QSvgFontStyle()
 
 void QSvgFontStyle::apply(QPainter *p, const QSvgNode *, QSvgExtraStates &states)
 {
-    m_oldQFont = p->font();
-    m_oldSvgFont = states.svgFont;
-    m_oldTextAnchor = states.textAnchor;
-    m_oldWeight = states.fontWeight;
-
     if (m_textAnchorSet)
         states.textAnchor = m_textAnchor;
 
-    QFont font = m_oldQFont;
+    QFont font = p->font();
     if (m_familySet) {
         states.svgFont = m_svgFont;
         font.setFamilies(m_qfont.families());
@@ -232,26 +232,15 @@ void QSvgFontStyle::apply(QPainter *p, const QSvgNode *, QSvgExtraStates &states
                                             static_cast<int>(QFont::Weight::Black))));
     }
 
-    p->setFont(font);
-}
-
-void QSvgFontStyle::revert(QPainter *p, QSvgExtraStates &states)
-{
-    p->setFont(m_oldQFont);
-    states.svgFont = m_oldSvgFont;
-    states.textAnchor = m_oldTextAnchor;
-    states.fontWeight = m_oldWeight;
+    states.setFont(p, font);
 }
 
 QSvgStrokeStyle::QSvgStrokeStyle()
     : m_strokeOpacity(1.0)
-    , m_oldStrokeOpacity(0.0)
     , m_strokeDashOffset(0)
-    , m_oldStrokeDashOffset(0)
     , m_style(0)
     , m_paintStyleResolved(1)
     , m_vectorEffect(0)
-    , m_oldVectorEffect(0)
     , m_strokeSet(0)
     , m_strokeDashArraySet(0)
     , m_strokeDashOffsetSet(0)
@@ -266,11 +255,6 @@ QSvgStrokeStyle::QSvgStrokeStyle()
 
 void QSvgStrokeStyle::apply(QPainter *p, const QSvgNode *n, QSvgExtraStates &states)
 {
-    m_oldStroke = p->pen();
-    m_oldStrokeOpacity = states.strokeOpacity;
-    m_oldStrokeDashOffset = states.strokeDashOffset;
-    m_oldVectorEffect = states.vectorEffect;
-
     QPen pen = p->pen();
 
     qreal oldWidth = pen.widthF();
@@ -350,14 +334,6 @@ void QSvgStrokeStyle::apply(QPainter *p, const QSvgNode *n, QSvgExtraStates &sta
     p->setPen(pen);
 }
 
-void QSvgStrokeStyle::revert(QPainter *p, QSvgExtraStates &states)
-{
-    p->setPen(m_oldStroke);
-    states.strokeOpacity = m_oldStrokeOpacity;
-    states.strokeDashOffset = m_oldStrokeDashOffset;
-    states.vectorEffect = m_oldVectorEffect;
-}
-
 void QSvgStrokeStyle::setDashArray(const QList<qreal> &dashes)
 {
     if (m_strokeWidthSet) {
@@ -384,8 +360,12 @@ QSvgGradientStyle::QSvgGradientStyle(QGradient *grad)
 {
 }
 
-QBrush QSvgGradientStyle::brush(QPainter *, const QSvgNode *, QSvgExtraStates &)
+QBrush QSvgGradientStyle::brush(QPainter *, const QSvgNode *node, QSvgExtraStates &)
 {
+    // The brush only depends on the gradient definition, so it is resolved once
+    if (m_brushResolved)
+        return m_brush;
+
     if (!m_link.isEmpty()) {
         resolveStops();
     }
@@ -396,18 +376,23 @@ QBrush QSvgGradientStyle::brush(QPainter *, const QSvgNode *, QSvgExtraStates &)
         m_gradientStopsSet = true;
     }
 
-    QBrush b(*m_gradient);
+    if (const QSvgTinyDocument *doc = node ? node->document() : nullptr)
+        m_gradient->setStops(doc->sharedGradientStops(m_gradient->stops()));
+
+    m_brush = QBrush(*m_gradient);
 
     if (!m_transform.isIdentity())
-        b.setTransform(m_transform);
+        m_brush.setTransform(m_transform);
 
-    return b;
+    m_brushResolved = true;
+    return m_brush;
 }
 
 
 void QSvgGradientStyle::setTransform(const QTransform &transform)
 {
     m_transform = transform;
+    m_brushResolved = false;
 }
 
 QSvgPatternStyle::QSvgPatternStyle(QSvgPattern *pattern)
@@ -420,7 +405,13 @@ QBrush QSvgPatternStyle::brush(QPainter *p, const QSvgNode *node, QSvgExtraState
 {
     m_patternImage = m_pattern->patternImage(p, states, node);
     QBrush b(m_patternImage);
-    b.setTransform(m_pattern->appliedTransform());
+    // Combined with the painter transform, a translation only transform lets the
+    // raster engine blit the tile directly, so keep it free of rounding noise
+    const QTransform &transform = m_pattern->appliedTransform();
+    if (transform.type() == QTransform::TxTranslate)
+        b.setTransform(QTransform::fromTranslate(transform.dx(), transform.dy()));
+    else if (!transform.isIdentity())
+        b.setTransform(transform);
     return b;
 }
 
@@ -431,13 +422,11 @@ QSvgTransformStyle::QSvgTransformStyle(const QTransform &trans)
 
 void QSvgTransformStyle::apply(QPainter *p, const QSvgNode *, QSvgExtraStates &)
 {
-    m_oldWorldTransform.push(p->worldTransform());
-    p->setWorldTransform(m_transform, true);
-}
-
-void QSvgTransformStyle::revert(QPainter *p, QSvgExtraStates &)
-{
-    p->setWorldTransform(m_oldWorldTransform.pop(), false /* don't combine */);
+    // Most transforms in exported documents are plain translations
+    if (m_transform.type() == QTransform::TxTranslate)
+        p->translate(m_transform.dx(), m_transform.dy());
+    else
+        p->setWorldTransform(m_transform, true);
 }
 
 QSvgStyleProperty::Type QSvgQualityStyle::type() const
@@ -494,15 +483,9 @@ QSvgCompOpStyle::QSvgCompOpStyle(QPainter::CompositionMode mode)
 
 void QSvgCompOpStyle::apply(QPainter *p, const QSvgNode *, QSvgExtraStates &)
 {
-    m_oldMode = p->compositionMode();
     p->setCompositionMode(m_mode);
 }
 
-void QSvgCompOpStyle::revert(QPainter *p, QSvgExtraStates &)
-{
-    p->setCompositionMode(m_oldMode);
-}
-
 QSvgStyleProperty::Type QSvgCompOpStyle::type() const
 {
     return COMP_OP;
@@ -514,89 +497,99 @@ QSvgStyle::~QSvgStyle()
 
 void QSvgStyle::apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states)
 {
-    if (quality) {
+    const quint8 saved = savedStates();
+    if (!saved)
+        return;
+
+    // Save everything the properties below may touch in one go, so that
+    // revert() is a single restore instead of one per property.
+    QSvgStyleState &state = states.styleStack.emplace_back(states);
+    if (saved & QSvgStyleState::Brush)
+        state.brush = p->brush();
+    if (saved & QSvgStyleState::Pen)
+        state.pen = p->pen();
+    if (saved & QSvgStyleState::Font)
+        state.font = p->font();
+    if (saved & QSvgStyleState::WorldTransform)
+        state.worldTransform = p->worldTransform();
+    if (saved & QSvgStyleState::Opacity)
+        state.opacity = p->opacity();
+    if (saved & QSvgStyleState::CompositionMode)
+        state.compositionMode = p->compositionMode();
+    if (saved & QSvgStyleState::SmoothPixmapTransform)
+        state.smoothPixmapTransform = p->testRenderHint(QPainter::SmoothPixmapTransform);
+
+    if (quality)
         quality->apply(p, node, states);
-    }
-
-    if (fill) {
+    if (fill)
         fill->apply(p, node, states);
-    }
-
-    if (viewportFill) {
+    if (viewportFill)
         viewportFill->apply(p, node, states);
-    }
-
-    if (font) {
+    if (font)
         font->apply(p, node, states);
-    }
-
-    if (stroke) {
+    if (stroke)
         stroke->apply(p, node, states);
-    }
-
-    if (transform) {
+    if (transform)
         transform->apply(p, node, states);
-    }
-
-    if (opacity) {
+    if (opacity)
         opacity->apply(p, node, states);
-    }
-
-    if (compop) {
+    if (compop)
         compop->apply(p, node, states);
-    }
 }
 
 void QSvgStyle::revert(QPainter *p, QSvgExtraStates &states)
 {
-    if (quality) {
-        quality->revert(p, states);
-    }
-
-    if (fill) {
-        fill->revert(p, states);
-    }
-
-    if (viewportFill) {
-        viewportFill->revert(p, states);
-    }
-
-    if (font) {
-        font->revert(p, states);
-    }
-
-    if (stroke) {
-        stroke->revert(p, states);
-    }
-
-    if (transform) {
-        transform->revert(p, states);
-    }
-
-    if (opacity) {
-        opacity->revert(p, states);
-    }
-
-    if (compop) {
-        compop->revert(p, states);
-    }
+    if (!savedStates())
+        return;
+
+    Q_ASSERT(!states.styleStack.isEmpty());
+    const QSvgStyleState state = states.styleStack.takeLast();
+    if (state.brush)
+        p->setBrush(*state.brush);
+    if (state.pen)
+        p->setPen(*state.pen);
+    if (state.font)
+        states.setFont(p, *state.font);
+    if (state.worldTransform)
+        states.setWorldTransform(p, *state.worldTransform);
+    if (state.opacity)
+        p->setOpacity(*state.opacity);
+    if (state.compositionMode)
+        p->setCompositionMode(*state.compositionMode);
+    if (state.smoothPixmapTransform)
+        p->setRenderHint(QPainter::SmoothPixmapTransform, *state.smoothPixmapTransform);
+    state.inherited.restore(states);
+}
+
+quint8 QSvgStyle::savedStates() const
+{
+    quint8 saved = 0;
+    if (quality)
+        saved |= QSvgStyleState::SmoothPixmapTransform;
+    if (fill || viewportFill)
+        saved |= QSvgStyleState::Brush;
+    if (font)
+        saved |= QSvgStyleState::Font;
+    if (stroke)
+        saved |= QSvgStyleState::Pen;
+    if (transform)
+        saved |= QSvgStyleState::WorldTransform;
+    if (opacity)
+        saved |= QSvgStyleState::Opacity;
+    if (compop)
+        saved |= QSvgStyleState::CompositionMode;
+    return saved;
 }
 
 QSvgOpacityStyle::QSvgOpacityStyle(qreal opacity)
-    : m_opacity(opacity), m_oldOpacity(0)
+    : m_opacity(opacity)
 {
 
 }
 
 void QSvgOpacityStyle::apply(QPainter *p, const QSvgNode *, QSvgExtraStates &)
 {
-    m_oldOpacity = p->opacity();
-    p->setOpacity(m_opacity * m_oldOpacity);
-}
-
-void QSvgOpacityStyle::revert(QPainter *p, QSvgExtraStates &)
-{
-    p->setOpacity(m_oldOpacity);
+    p->setOpacity(m_opacity * p->opacity());
 }
 
 QSvgStyleProperty::Type QSvgOpacityStyle::type() const
@@ -608,6 +601,7 @@ void QSvgGradientStyle::setStopLink(const QString &link, QSvgTinyDocument *doc)
 {
     m_link = link;
     m_doc  = doc;
+    m_brushResolved = false;
 }
 
 void QSvgGradientStyle::resolveStops()
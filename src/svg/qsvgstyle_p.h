@@ -15,6 +15,7 @@
 // We mean it.
 //
 
+#include "QtCore/qlist.h"
 #include "QtCore/qstack.h"
 #include "QtGui/qpainter.h"
 #include "QtGui/qpen.h"
@@ -25,6 +26,8 @@
 #include <qdebug.h>
 #include "qtsvgglobal_p.h"
 
+#include <optional>
+
 QT_BEGIN_NAMESPACE
 
 class QPainter;
@@ -102,6 +105,66 @@ private:
     int _ref;
 };
 
+struct QSvgExtraStates;
+
+// The members of QSvgExtraStates that child nodes inherit and that affect how
+// they are drawn. Cached renderings compare them to tell whether they can be reused.
+struct QSvgInheritedStates
+{
+    explicit QSvgInheritedStates(const QSvgExtraStates &states);
+    void restore(QSvgExtraStates &states) const;
+
+    friend bool operator==(const QSvgInheritedStates &a, const QSvgInheritedStates &b)
+    {
+        return a.fillOpacity == b.fillOpacity && a.strokeOpacity == b.strokeOpacity
+                && a.svgFont == b.svgFont && a.textAnchor == b.textAnchor
+                && a.fontWeight == b.fontWeight && a.fillRule == b.fillRule
+                && a.strokeDashOffset == b.strokeDashOffset && a.vectorEffect == b.vectorEffect
+                && a.imageRendering == b.imageRendering;
+    }
+    friend bool operator!=(const QSvgInheritedStates &a, const QSvgInheritedStates &b)
+    {
+        return !(a == b);
+    }
+
+    qreal fillOpacity;
+    qreal strokeOpacity;
+    QSvgFont *svgFont;
+    Qt::Alignment textAnchor;
+    int fontWeight;
+    Qt::FillRule fillRule;
+    qreal strokeDashOffset;
+    bool vectorEffect;
+    qint8 imageRendering;
+};
+
+// Painter and inherited state saved by QSvgStyle::apply() and restored by
+// QSvgStyle::revert(). Only the painter attributes the style changes are saved,
+// the others are left empty and not touched on revert.
+struct QSvgStyleState
+{
+    enum SavedState : quint8 {
+        Brush = 0x01,
+        Pen = 0x02,
+        Font = 0x04,
+        WorldTransform = 0x08,
+        Opacity = 0x10,
+        CompositionMode = 0x20,
+        SmoothPixmapTransform = 0x40
+    };
+
+    explicit QSvgStyleState(const QSvgExtraStates &states) : inherited(states) { }
+
+    std::optional<QBrush> brush;
+    std::optional<QPen> pen;
+    std::optional<QFont> font;
+    std::optional<QTransform> worldTransform;
+    std::optional<qreal> opacity;
+    std::optional<QPainter::CompositionMode> compositionMode;
+    std::optional<bool> smoothPixmapTransform;
+    QSvgInheritedStates inherited;
+};
+
 struct Q_SVG_EXPORT QSvgExtraStates
 {
     QSvgExtraStates();
@@ -118,6 +181,15 @@ struct Q_SVG_EXPORT QSvgExtraStates
     bool vectorEffect; // true if pen is cosmetic
     qint8 imageRendering; // QSvgQualityStyle::ImageRendering
     bool inUse = false; // true if currently in QSvgUseNode
+    QList<QSvgStyleState> styleStack; // one entry per applied, non-empty QSvgStyle
+
+    // QPainter updates its font and world transform even when they are unchanged.
+    // These setters skip the call in that case, counting issued and elided updates
+    // for profiling.
+    void setFont(QPainter *p, const QFont &font);
+    void setWorldTransform(QPainter *p, const QTransform &transform);
+    quint64 painterUpdatesIssued = 0;
+    quint64 painterUpdatesElided = 0;
 };
 
 class Q_SVG_EXPORT QSvgStyleProperty : public QSvgRefCounted
@@ -142,7 +214,6 @@ public:
 public:
     virtual ~QSvgStyleProperty();
     virtual void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) = 0;
-    virtual void revert(QPainter *p, QSvgExtraStates &states) =0;
     virtual Type type() const=0;
     bool isDefault() const { return false; } // [not virtual since called from templated class]
 };
@@ -152,7 +223,6 @@ class Q_SVG_EXPORT QSvgPaintStyleProperty : public QSvgStyleProperty
 public:
     virtual QBrush brush(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) = 0;
     void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) override;
-    void revert(QPainter *p, QSvgExtraStates &states) override;
 };
 
 class Q_SVG_EXPORT QSvgQualityStyle : public QSvgStyleProperty
@@ -166,7 +236,6 @@ public:
 
     QSvgQualityStyle(int color);
     void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) override;
-    void revert(QPainter *p, QSvgExtraStates &states) override;
     Type type() const override;
 
     void setImageRendering(ImageRendering);
@@ -191,7 +260,6 @@ private:
     // image-rendering v 	v 	'auto' | 'optimizeSpeed' | 'optimizeQuality' |
     //                                      'inherit'
     qint32 m_imageRendering: 4;
-    qint32 m_oldImageRendering: 4;
     quint32 m_imageRenderingSet: 1;
 };
 
@@ -202,14 +270,12 @@ class Q_SVG_EXPORT QSvgOpacityStyle : public QSvgStyleProperty
 public:
     QSvgOpacityStyle(qreal opacity);
     void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) override;
-    void revert(QPainter *p, QSvgExtraStates &states) override;
     Type type() const override;
     qreal opacity() const { return m_opacity; }
     bool isDefault() const { return qFuzzyCompare(m_opacity, qreal(1.0)); }
 
 private:
     qreal m_opacity;
-    qreal m_oldOpacity;
 };
 
 class Q_SVG_EXPORT QSvgFillStyle : public QSvgStyleProperty
@@ -217,7 +283,6 @@ class Q_SVG_EXPORT QSvgFillStyle : public QSvgStyleProperty
 public:
     QSvgFillStyle();
     void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) override;
-    void revert(QPainter *p, QSvgExtraStates &states) override;
     Type type() const override;
 
     void setFillRule(Qt::FillRule f);
@@ -269,13 +334,10 @@ private:
     // fill            v 	v 	'inherit' | <Paint.datatype>
     // fill-opacity    v 	v 	'inherit' | <OpacityValue.datatype>
     QBrush m_fill;
-    QBrush m_oldFill;
     QSvgPaintStyleProperty *m_style;
 
     Qt::FillRule m_fillRule;
-    Qt::FillRule m_oldFillRule;
     qreal m_fillOpacity;
-    qreal m_oldFillOpacity;
 
     QString m_paintStyleId;
     uint m_paintStyleResolved : 1;
@@ -290,7 +352,6 @@ class Q_SVG_EXPORT QSvgViewportFillStyle : public QSvgStyleProperty
 public:
     QSvgViewportFillStyle(const QBrush &brush);
     void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) override;
-    void revert(QPainter *p, QSvgExtraStates &states) override;
     Type type() const override;
 
     const QBrush & qbrush() const
@@ -302,7 +363,6 @@ private:
     // viewport-fill-opacity 	v 	x 	'inherit' | <OpacityValue.datatype>
     QBrush m_viewportFill;
 
-    QBrush m_oldFill;
 };
 
 class Q_SVG_EXPORT QSvgFontStyle : public QSvgStyleProperty
@@ -314,7 +374,6 @@ public:
     QSvgFontStyle(QSvgFont *font, QSvgTinyDocument *doc);
     QSvgFontStyle();
     void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) override;
-    void revert(QPainter *p, QSvgExtraStates &states) override;
     Type type() const override;
 
     void setSize(qreal size)
@@ -374,11 +433,6 @@ private:
     int m_weight;
     Qt::Alignment m_textAnchor;
 
-    QSvgFont *m_oldSvgFont;
-    QFont m_oldQFont;
-    Qt::Alignment m_oldTextAnchor;
-    int m_oldWeight;
-
     uint m_familySet : 1;
     uint m_sizeSet : 1;
     uint m_styleSet : 1;
@@ -392,7 +446,6 @@ class Q_SVG_EXPORT QSvgStrokeStyle : public QSvgStyleProperty
 public:
     QSvgStrokeStyle();
     void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) override;
-    void revert(QPainter *p, QSvgExtraStates &states) override;
     Type type() const override;
 
     void setStroke(QBrush brush)
@@ -504,17 +557,13 @@ private:
     // stroke-opacity    v 	v 	'inherit' | <OpacityValue.datatype>
     // stroke-width      v 	v 	'inherit' | <StrokeWidthValue.datatype>
     QPen m_stroke;
-    QPen m_oldStroke;
     qreal m_strokeOpacity;
-    qreal m_oldStrokeOpacity;
     qreal m_strokeDashOffset;
-    qreal m_oldStrokeDashOffset;
 
     QSvgPaintStyleProperty *m_style;
     QString m_paintStyleId;
     uint m_paintStyleResolved : 1;
     uint m_vectorEffect : 1;
-    uint m_oldVectorEffect : 1;
 
     uint m_strokeSet : 1;
     uint m_strokeDashArraySet : 1;
@@ -548,8 +597,6 @@ private:
     // solid-opacity     v 	x 	'inherit' | <OpacityValue.datatype>
     QColor m_solidColor;
 
-    QBrush m_oldFill;
-    QPen   m_oldStroke;
 };
 
 class Q_SVG_EXPORT QSvgGradientStyle : public QSvgPaintStyleProperty
@@ -583,12 +630,15 @@ public:
     void setGradientStopsSet(bool set)
     {
         m_gradientStopsSet = set;
+        m_brushResolved = false;
     }
 
     QBrush brush(QPainter *, const QSvgNode *, QSvgExtraStates &) override;
 private:
     QGradient      *m_gradient;
     QTransform m_transform;
+    QBrush m_brush;
+    bool m_brushResolved = false;
 
     QSvgTinyDocument *m_doc;
     QString           m_link;
@@ -616,7 +666,6 @@ class Q_SVG_EXPORT QSvgTransformStyle : public QSvgStyleProperty
 public:
     QSvgTransformStyle(const QTransform &transform);
     void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) override;
-    void revert(QPainter *p, QSvgExtraStates &states) override;
     Type type() const override;
 
     const QTransform & qtransform() const
@@ -627,7 +676,6 @@ public:
 private:
     //7.6 The transform  attribute
     QTransform m_transform;
-    QStack<QTransform> m_oldWorldTransform;
 };
 
 class Q_SVG_EXPORT QSvgCompOpStyle : public QSvgStyleProperty
@@ -635,7 +683,6 @@ class Q_SVG_EXPORT QSvgCompOpStyle : public QSvgStyleProperty
 public:
     QSvgCompOpStyle(QPainter::CompositionMode mode);
     void apply(QPainter *p, const QSvgNode *node, QSvgExtraStates &states) override;
-    void revert(QPainter *p, QSvgExtraStates &states) override;
     Type type() const override;
 
     const QPainter::CompositionMode & compOp() const
@@ -645,8 +692,6 @@ public:
 private:
     //comp-op attribute
     QPainter::CompositionMode m_mode;
-
-    QPainter::CompositionMode m_oldMode;
 };
 
 
@@ -681,6 +726,9 @@ public:
     QSvgRefCounter<QSvgTransformStyle>    transform;
     QSvgRefCounter<QSvgOpacityStyle>      opacity;
     QSvgRefCounter<QSvgCompOpStyle>       compop;
+
+private:
+    quint8 savedStates() const;
 };
 
 /********************************************************/
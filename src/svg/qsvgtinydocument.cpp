@@ -23,10 +23,22 @@ QT_BEGIN_NAMESPACE
 
 using namespace Qt::StringLiterals;
 
+// Decoded <image> content is limited per document, in kilobytes
+static constexpr qsizetype decodedImageCacheBudget = 64 * 1024;
+// Filter results kept for animations are limited per document, in kilobytes
+static constexpr qsizetype filterResultCacheBudget = 32 * 1024;
+// Sprites of <use> targets and markers are limited per document, in kilobytes
+static constexpr qsizetype spriteCacheBudget = 32 * 1024;
+// Nesting depth of styled nodes the style stack is sized for before it grows
+static constexpr qsizetype styleStackReserve = 32;
+
 QSvgTinyDocument::QSvgTinyDocument(QtSvg::Options options)
     : QSvgStructureNode(0)
     , m_widthPercent(false)
     , m_heightPercent(false)
+    , m_sprites(spriteCacheBudget)
+    , m_decodedImages(decodedImageCacheBudget)
+    , m_filterResults(filterResultCacheBudget)
     , m_animated(false)
     , m_fps(30)
     , m_options(options)
@@ -246,6 +258,9 @@ void QSvgTinyDocument::draw(QPainter *p, const QRectF &bounds)
     //### not the most optimal way
     mapSourceToTarget(p, bounds);
     initPainter(p);
+    m_states.styleStack.reserve(styleStackReserve);
+    m_states.painterUpdatesIssued = 0;
+    m_states.painterUpdatesElided = 0;
     QList<QSvgNode*>::iterator itr = m_renderers.begin();
     applyStyle(p, m_states);
     while (itr != m_renderers.end()) {
@@ -256,6 +271,8 @@ void QSvgTinyDocument::draw(QPainter *p, const QRectF &bounds)
     }
     revertStyle(p, m_states);
     p->restore();
+    qCDebug(lcSvgDraw) << "Painter state updates:" << m_states.painterUpdatesIssued << "issued,"
+                       << m_states.painterUpdatesElided << "elided as redundant";
 }
 
 
@@ -294,6 +311,9 @@ void QSvgTinyDocument::draw(QPainter *p, const QString &id,
         parent = parent->parent();
     }
 
+    m_states.styleStack.reserve(qMax(styleStackReserve, parentApplyStack.size()));
+    m_states.painterUpdatesIssued = 0;
+    m_states.painterUpdatesElided = 0;
     for (int i = parentApplyStack.size() - 1; i >= 0; --i)
         parentApplyStack[i]->applyStyle(p, m_states);
 
@@ -312,6 +332,8 @@ void QSvgTinyDocument::draw(QPainter *p, const QString &id,
     //p->fillRect(bounds.adjusted(-5, -5, 5, 5), QColor(0, 0, 255, 100));
 
     p->restore();
+    qCDebug(lcSvgDraw) << "Painter state updates:" << m_states.painterUpdatesIssued << "issued,"
+                       << m_states.painterUpdatesElided << "elided as redundant";
 }
 
 QSvgNode::Type QSvgTinyDocument::type() const
@@ -380,6 +402,106 @@ QSvgPaintStyleProperty *QSvgTinyDocument::namedStyle(const QString &id) const
     return m_namedStyles.value(id);
 }
 
+// Returns a list equal to stops, which shares its data with all identical lists
+// of the document. The raster engine caches color tables for gradients by their
+// stops, so gradients with shared stops are matched by a data pointer comparison.
+QGradientStops QSvgTinyDocument::sharedGradientStops(const QGradientStops &stops) const
+{
+    size_t hash = 0;
+    for (const QGradientStop &stop : stops)
+        hash = qHashMulti(hash, stop.first, quint64(stop.second.rgba64()));
+
+    for (auto it = m_gradientStops.constFind(hash); it != m_gradientStops.cend() && it.key() == hash; ++it) {
+        if (it.value() == stops)
+            return it.value();
+    }
+    m_gradientStops.insert(hash, stops);
+    return stops;
+}
+
+QSvgSprite *QSvgSprite::create(const QImage &image, QPainter *p, const QSvgExtraStates &states,
+                               quint64 frame, bool tooLarge)
+{
+    return new QSvgSprite{ image, p->pen(), p->brush(), p->font(), p->opacity(), p->renderHints(),
+                           QSvgInheritedStates(states), frame, tooLarge };
+}
+
+// Distinguishes the inherited states that sprites of the same content are drawn with.
+// Matches are verified with matches(), so the hash does not need to cover everything
+// that is compared there.
+size_t QSvgSprite::contextHash(QPainter *p, const QSvgExtraStates &states)
+{
+    const QPen &pen = p->pen();
+    const QBrush &brush = p->brush();
+    return qHashMulti(0, int(pen.style()), pen.widthF(), quint64(pen.color().rgba64()),
+                      int(brush.style()), quint64(brush.color().rgba64()), p->font(), p->opacity(),
+                      states.fillOpacity, states.strokeOpacity, int(states.fillRule));
+}
+
+bool QSvgSprite::matches(QPainter *p, const QSvgExtraStates &states) const
+{
+    return pen == p->pen() && brush == p->brush() && font == p->font()
+            && opacity == p->opacity() && renderHints == p->renderHints()
+            && this->states == QSvgInheritedStates(states);
+}
+
+QSvgSprite *QSvgTinyDocument::sprite(const QSvgSpriteKey &key) const
+{
+    return m_sprites.object(key);
+}
+
+// Takes ownership of sprite, which replaces any sprite cached for the same key
+void QSvgTinyDocument::cacheSprite(const QSvgSpriteKey &key, QSvgSprite *sprite)
+{
+    m_sprites.insert(key, sprite, qMax(qsizetype(1), sprite->image.sizeInBytes() / 1024));
+}
+
+// Marker placements only depend on the geometry of the decorated node, which is
+// not animated, so they are computed once
+QList<QSvgMarkerPlacement> QSvgTinyDocument::markerPlacements(const QSvgNode *node)
+{
+    auto it = m_markerPlacements.constFind(node);
+    if (it == m_markerPlacements.cend())
+        it = m_markerPlacements.insert(node, QSvgMarker::placementsForNode(node));
+    return it.value();
+}
+
+const QImage *QSvgTinyDocument::decodedImage(const QSvgNode *node) const
+{
+    return m_decodedImages.object({ node, QSize(), false });
+}
+
+// Images larger than the budget are not kept, and decoded again when drawn
+void QSvgTinyDocument::cacheDecodedImage(const QSvgNode *node, const QImage &image)
+{
+    m_decodedImages.insert({ node, QSize(), false }, new QImage(image),
+                           qMax(qsizetype(1), image.sizeInBytes() / 1024));
+}
+
+const QImage *QSvgTinyDocument::displayImage(const QSvgNode *node, QSize size, bool smooth) const
+{
+    return m_decodedImages.object({ node, size, smooth });
+}
+
+// Resampled images share the budget of decoded images
+void QSvgTinyDocument::cacheDisplayImage(const QSvgNode *node, QSize size, bool smooth,
+                                         const QImage &image)
+{
+    m_decodedImages.insert({ node, size, smooth }, new QImage(image),
+                           qMax(qsizetype(1), image.sizeInBytes() / 1024));
+}
+
+QSvgFilterResult *QSvgTinyDocument::filterResult(const QSvgFilterResultKey &key) const
+{
+    return m_filterResults.object(key);
+}
+
+// Takes ownership of result, which replaces any result cached for the same key
+void QSvgTinyDocument::cacheFilterResult(const QSvgFilterResultKey &key, QSvgFilterResult *result)
+{
+    m_filterResults.insert(key, result, qMax(qsizetype(1), result->image.sizeInBytes() / 1024));
+}
+
 void QSvgTinyDocument::restartAnimation()
 {
     m_animator->restartAnimation();
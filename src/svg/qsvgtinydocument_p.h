@@ -21,6 +21,7 @@
 #include "QtCore/qrect.h"
 #include "QtCore/qlist.h"
 #include "QtCore/qhash.h"
+#include "QtCore/qcache.h"
 #include "QtCore/qdatetime.h"
 #include "QtCore/qxmlstream.h"
 #include "QtCore/qsharedpointer.h"
@@ -35,6 +36,100 @@ class QByteArray;
 class QSvgFont;
 class QTransform;
 
+// Identifies the sprite of a <use> target or a marker for the linear part of the device
+// transform, the subpixel phase and a hash of the inherited state
+struct QSvgSpriteKey
+{
+    const QSvgNode *node;
+    qreal m11, m12, m21, m22;
+    QPoint phase;
+    size_t context;
+
+    friend bool operator==(const QSvgSpriteKey &a, const QSvgSpriteKey &b) noexcept
+    {
+        return a.node == b.node && a.m11 == b.m11 && a.m12 == b.m12 && a.m21 == b.m21
+                && a.m22 == b.m22 && a.phase == b.phase && a.context == b.context;
+    }
+    friend size_t qHash(const QSvgSpriteKey &key, size_t seed = 0) noexcept
+    {
+        return qHashMulti(seed, key.node, key.m11, key.m12, key.m21, key.m22,
+                          key.phase.x(), key.phase.y(), key.context);
+    }
+};
+
+// A rendering of the content of a <use> element or a marker that other instances can
+// blit, together with the inherited state it was drawn with. A null image marks content
+// that was seen once, or that is too large for a sprite.
+struct QSvgSprite
+{
+    static QSvgSprite *create(const QImage &image, QPainter *p, const QSvgExtraStates &states,
+                              quint64 frame, bool tooLarge);
+    static size_t contextHash(QPainter *p, const QSvgExtraStates &states);
+    bool matches(QPainter *p, const QSvgExtraStates &states) const;
+
+    QImage image;
+    QPen pen;
+    QBrush brush;
+    QFont font;
+    qreal opacity;
+    QPainter::RenderHints renderHints;
+    QSvgInheritedStates states;
+    quint64 frame;
+    bool tooLarge;
+};
+
+// Identifies the decoded pixels of an <image>. A null display size denotes the image as
+// decoded, any other size the image resampled for the device pixels it covers.
+struct QSvgDecodedImageKey
+{
+    const QSvgNode *node;
+    QSize displaySize;
+    bool smooth;
+
+    friend bool operator==(const QSvgDecodedImageKey &a, const QSvgDecodedImageKey &b) noexcept
+    {
+        return a.node == b.node && a.displaySize == b.displaySize && a.smooth == b.smooth;
+    }
+    friend size_t qHash(const QSvgDecodedImageKey &key, size_t seed = 0) noexcept
+    {
+        return qHashMulti(seed, key.node, key.displaySize.width(), key.displaySize.height(),
+                          key.smooth);
+    }
+};
+
+// Identifies the filter result of a node for the linear part of its device transform.
+// Instances that differ only by a translation share the result.
+struct QSvgFilterResultKey
+{
+    const QSvgNode *node;
+    qreal m11, m12, m21, m22;
+
+    friend bool operator==(const QSvgFilterResultKey &a, const QSvgFilterResultKey &b) noexcept
+    {
+        return a.node == b.node && a.m11 == b.m11 && a.m12 == b.m12
+                && a.m21 == b.m21 && a.m22 == b.m22;
+    }
+    friend size_t qHash(const QSvgFilterResultKey &key, size_t seed = 0) noexcept
+    {
+        return qHashMulti(seed, key.node, key.m11, key.m12, key.m21, key.m22);
+    }
+};
+
+// A filtered rendering of a node, kept so that later frames of an animation can reuse it,
+// together with the painter and inherited state it was drawn with
+struct QSvgFilterResult
+{
+    QImage image;
+    QPointF translation;
+    QRectF targetRegion;
+    QPen pen;
+    QBrush brush;
+    QFont font;
+    QPainter::RenderHints renderHints;
+    QSvgInheritedStates states;
+    quint64 frame;
+};
+
 class Q_SVG_EXPORT QSvgTinyDocument : public QSvgStructureNode
 {
 public:
@@ -80,6 +175,16 @@ public:
     QSvgNode *namedNode(const QString &id) const;
     void addNamedStyle(const QString &id, QSvgPaintStyleProperty *style);
     QSvgPaintStyleProperty *namedStyle(const QString &id) const;
+    QGradientStops sharedGradientStops(const QGradientStops &stops) const;
+    QSvgSprite *sprite(const QSvgSpriteKey &key) const;
+    void cacheSprite(const QSvgSpriteKey &key, QSvgSprite *sprite);
+    QList<QSvgMarkerPlacement> markerPlacements(const QSvgNode *node);
+    const QImage *decodedImage(const QSvgNode *node) const;
+    void cacheDecodedImage(const QSvgNode *node, const QImage &image);
+    const QImage *displayImage(const QSvgNode *node, QSize size, bool smooth) const;
+    void cacheDisplayImage(const QSvgNode *node, QSize size, bool smooth, const QImage &image);
+    QSvgFilterResult *filterResult(const QSvgFilterResultKey &key) const;
+    void cacheFilterResult(const QSvgFilterResultKey &key, QSvgFilterResult *result);
 
     void restartAnimation();
     inline int currentElapsed() const;
@@ -106,6 +211,11 @@ private:
     QHash<QString, QSvgRefCounter<QSvgFont> > m_fonts;
     QHash<QString, QSvgNode *> m_namedNodes;
     QHash<QString, QSvgRefCounter<QSvgPaintStyleProperty> > m_namedStyles;
+    mutable QMultiHash<size_t, QGradientStops> m_gradientStops;
+    QCache<QSvgSpriteKey, QSvgSprite> m_sprites;
+    QHash<const QSvgNode *, QList<QSvgMarkerPlacement>> m_markerPlacements;
+    QCache<QSvgDecodedImageKey, QImage> m_decodedImages;
+    QCache<QSvgFilterResultKey, QSvgFilterResult> m_filterResults;
 
     bool  m_animated;
     int   m_fps;
@@ -112,6 +112,7 @@ void QSvgVisitor::traverse(const QSvgNode *node)
     case QSvgNode::Symbol:
     case QSvgNode::Marker:
     case QSvgNode::Pattern:
+    case QSvgNode::ClipPath:
     case QSvgNode::Filter:
     case QSvgNode::FeMerge:
     case QSvgNode::FeMergenode:
@@ -121,6 +122,10 @@ void QSvgVisitor::traverse(const QSvgNode *node)
     case QSvgNode::FeComposite:
     case QSvgNode::FeFlood:
     case QSvgNode::FeBlend:
+    case QSvgNode::FeTurbulence:
+    case QSvgNode::FeConvolvematrix:
+    case QSvgNode::FeMorphology:
+    case QSvgNode::FeDisplacementmap:
     case QSvgNode::FeUnsupported:
         qDebug() << "Unhandled type in switch" << node->type();
         break;
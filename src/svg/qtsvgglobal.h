@@ -16,6 +16,8 @@ enum Option : quint32 {
     NoOption           = 0x00,
     Tiny12FeaturesOnly = 0x01,
     AssumeTrustedSource = 0x02,
+    HighPrecisionFilters = 0x04,
+    TextAsPaths = 0x08,
 };
 Q_DECLARE_FLAGS(Options, Option)
 Q_DECLARE_OPERATORS_FOR_FLAGS(Options)
@@ -60,7 +60,9 @@ private slots:
     void strokeInherit();
     void testFillInheritance();
     void testStopOffsetOpacity();
+    void testSharedGradientStops();
     void testUseElement();
+    void testUseSprites();
     void smallFont();
     void styleSheet();
     void duplicateStyleId();
@@ -69,15 +71,35 @@ private slots:
     void ossFuzzLoad_data();
     void ossFuzzLoad();
     void imageRendering();
+    void imageDecodedAtDisplaySize();
+    void imageResampledForDisplay();
+    void imageFormatPinned();
     void illegalAnimateTransform_data();
     void illegalAnimateTransform();
     void tSpanLineBreak();
     void animated();
     void notAnimated();
     void testMaskElement();
+    void testClipPath();
+    void testBinaryMask();
+    void testGrayscaleMask();
     void testSymbol();
     void testMarker();
+    void testMarkerSprites();
+    void testTextLayoutCache();
+    void testSvgFontGlyphs();
+    void testTextAsPaths();
+    void testStyleStateRestored();
+    void testSharedStyleProperties();
+    void testCssRuleIndex();
+    void testColorParsing_data();
+    void testColorParsing();
+    void testTransformParsing_data();
+    void testTransformParsing();
+    void testNoOpStyleProperties();
+    void testPainterStateTracking();
     void testPatternElement();
+    void testPatternTileFormat();
     void testCycles();
     void testFeFlood();
     void testFeOffset();
@@ -85,7 +107,18 @@ private slots:
     void testFeMerge();
     void testFeComposite();
     void testFeGaussian();
+    void testFeGaussianOptimizeSpeed();
     void testFeBlend();
+    void testFeMorphology();
+    void testFeConvolveMatrix();
+    void testFeTurbulence();
+    void testFeDisplacementMap();
+    void testFilterRegionOfInterest();
+    void testFilterEmptyPrimitiveOutput();
+    void testFilterAnimationCache();
+    void testPatternTileCache();
+    void testHighPrecisionFilters();
+    void testLinearLightFilters();
 
 #ifndef QT_NO_COMPRESS
     void testGzLoading();
@@ -108,6 +141,70 @@ tst_QSvgRenderer::~tst_QSvgRenderer()
 {
 }
 
+static QImage renderToImage(QSvgRenderer &renderer, const QSize &size,
+                            const QColor &background = Qt::transparent)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(background);
+    QPainter p(&image);
+    renderer.render(&p);
+    p.end();
+    return image;
+}
+
+static QImage renderToImage(const QByteArray &svgDoc, const QSize &size,
+                            const QColor &background = Qt::transparent)
+{
+    QSvgRenderer renderer(svgDoc);
+    return renderToImage(renderer, size, background);
+}
+
+// Enables the debug output of a logging category and collects it while in scope. The
+// previous logging filter and message handler are restored when it goes out of scope.
+class SvgLog
+{
+public:
+    explicit SvgLog(const char *category)
+    {
+        s_category = category;
+        s_messages.clear();
+        m_previousFilter = QLoggingCategory::installFilter(filter);
+        s_previousHandler = qInstallMessageHandler(handler);
+    }
+    ~SvgLog()
+    {
+        qInstallMessageHandler(s_previousHandler);
+        QLoggingCategory::installFilter(m_previousFilter);
+    }
+    Q_DISABLE_COPY_MOVE(SvgLog)
+
+    const QStringList &messages() const { return s_messages; }
+    qsizetype count(const QString &prefix) const
+    {
+        return std::count_if(s_messages.cbegin(), s_messages.cend(),
+                             [&](const QString &message) { return message.startsWith(prefix); });
+    }
+
+private:
+    static void filter(QLoggingCategory *category)
+    {
+        if (qstrcmp(category->categoryName(), s_category) == 0)
+            category->setEnabled(QtDebugMsg, true);
+    }
+    static void handler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+    {
+        if (qstrcmp(context.category, s_category) == 0)
+            s_messages.append(message);
+        else if (s_previousHandler)
+            s_previousHandler(type, context, message);
+    }
+
+    static inline const char *s_category = nullptr;
+    static inline QStringList s_messages;
+    static inline QtMessageHandler s_previousHandler = nullptr;
+    QLoggingCategory::CategoryFilter m_previousFilter = nullptr;
+};
+
 // Testing get/set functions
 void tst_QSvgRenderer::getSetCheck()
 {
@@ -1503,6 +1600,39 @@ void tst_QSvgRenderer::testStopOffsetOpacity()
     QCOMPARE(images[0], images[3]);
 }
 
+void tst_QSvgRenderer::testSharedGradientStops()
+{
+    // Identical and referenced stop lists, each gradient keeping its own geometry
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <linearGradient id="a">
+                      <stop offset="0" stop-color="red"/>
+                      <stop offset="1" stop-color="blue"/>
+                      </linearGradient>
+                      <linearGradient id="b" x1="1" x2="0">
+                      <stop offset="0" stop-color="red"/>
+                      <stop offset="1" stop-color="blue"/>
+                      </linearGradient>
+                      <linearGradient id="c" xlink:href="#a" gradientTransform="translate(0.5 0)"/>
+                      <rect width="100" height="30" fill="url(#a)"/>
+                      <rect y="35" width="100" height="30" fill="url(#b)"/>
+                      <rect y="70" width="100" height="30" fill="url(#c)"/>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    const QImage image = renderToImage(renderer, QSize(100, 100));
+    QVERIFY(qRed(image.pixel(2, 10)) > 240);
+    QVERIFY(qBlue(image.pixel(97, 10)) > 240);
+    QVERIFY(qBlue(image.pixel(2, 45)) > 240);
+    QVERIFY(qRed(image.pixel(97, 45)) > 240);
+    QVERIFY(qRed(image.pixel(52, 85)) > 240);
+    QVERIFY(qBlue(image.pixel(97, 85)) > 100);
+
+    // Resolved brushes are reused when painting again
+    QCOMPARE(renderToImage(renderer, QSize(100, 100)), image);
+}
+
 void tst_QSvgRenderer::testUseElement()
 {
     static const char *svgs[] = {
@@ -1671,6 +1801,39 @@ void tst_QSvgRenderer::testUseElement()
     }
 }
 
+void tst_QSvgRenderer::testUseSprites()
+{
+    // With optimizeSpeed, repeated instances are blitted from a sprite. At whole pixel
+    // positions, they match drawing each instance.
+    const QByteArray svgTemplate(R"(<svg width="100" height="100" image-rendering="%1">
+                                 <symbol id="marker">
+                                 <rect width="8" height="8" fill="red"/>
+                                 <rect x="2" y="2" width="4" height="4"/>
+                                 </symbol>
+                                 <use href="#marker" x="0" y="0" fill="blue"/>
+                                 <use href="#marker" x="10" y="10" fill="blue"/>
+                                 <use href="#marker" x="20" y="20" fill="blue"/>
+                                 <use href="#marker" x="30" y="30"/>
+                                 <use href="#marker" x="40" y="40"/>
+                                 <g transform="scale(2)">
+                                 <use href="#marker" x="30" y="0" fill="blue"/>
+                                 <use href="#marker" x="40" y="0" fill="blue"/>
+                                 </g>
+                                 </svg>)");
+
+    const QImage sprites = renderToImage(QByteArray(svgTemplate).replace("%1", "optimizeSpeed"),
+                                         QSize(100, 100));
+    QCOMPARE(sprites, renderToImage(QByteArray(svgTemplate).replace("%1", "optimizeQuality"),
+                                    QSize(100, 100)));
+
+    // Inherited fill differs between instances
+    QCOMPARE(sprites.pixel(24, 24), qRgb(0, 0, 255));
+    QCOMPARE(sprites.pixel(44, 44), qRgb(0, 0, 0));
+    QCOMPARE(sprites.pixel(90, 8), qRgb(0, 0, 255));
+    QCOMPARE(sprites.pixel(81, 1), qRgb(255, 0, 0));
+    QCOMPARE(sprites.pixel(97, 1), qRgba(0, 0, 0, 0));
+}
+
 void tst_QSvgRenderer::smallFont()
 {
     static const char *svgs[] = { R"(<svg width="50px" height="50px"><text x="10" y="10" font-size="0">Hello world</text></svg>)",
@@ -1817,6 +1980,98 @@ void tst_QSvgRenderer::imageRendering() {
     }
 }
 
+void tst_QSvgRenderer::imageDecodedAtDisplaySize()
+{
+    // A large embedded image drawn into a small slot is decoded when drawn, at the
+    // size it covers
+    QImage img(256, 256, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::red);
+    for (int y = 0; y < img.height(); ++y) {
+        for (int x = img.width() / 2; x < img.width(); ++x)
+            img.setPixel(x, y, qRgb(0, 0, 255));
+    }
+    const QByteArray svg = "<svg width='20' height='20'><image xlink:href='" + image_data_url(img)
+            + "' x='2' y='2' width='16' height='16'/></svg>";
+
+    QSvgRenderer renderer(svg);
+    QVERIFY(renderer.isValid());
+
+    const QImage image = renderToImage(renderer, QSize(20, 20));
+    QCOMPARE(image.pixel(4, 10), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(15, 10), qRgb(0, 0, 255));
+    QCOMPARE(image.pixel(1, 10), qRgba(0, 0, 0, 0));
+    QCOMPARE(renderToImage(renderer, QSize(20, 20)), image);
+
+    // Data that cannot be read is still rejected when parsing
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Could not create image from"));
+    QSvgRenderer invalid(QByteArray("<svg><image xlink:href='data:image/png;base64,AAAA' width='2' height='2'/></svg>"));
+}
+
+void tst_QSvgRenderer::imageResampledForDisplay()
+{
+    // Downscaled with optimizeQuality, single pixel stripes average out rather than
+    // picking either color
+    QImage img(256, 256, QImage::Format_RGB32);
+    for (int y = 0; y < img.height(); ++y) {
+        for (int x = 0; x < img.width(); ++x)
+            img.setPixel(x, y, (x & 1) ? qRgb(255, 255, 255) : qRgb(0, 0, 0));
+    }
+    const QByteArray svg = "<svg width='32' height='32' image-rendering='optimizeQuality'>"
+            "<image xlink:href='" + image_data_url(img) + "' width='16' height='16'/>"
+            "<image xlink:href='" + image_data_url(img) + "' x='16' y='16' width='16' height='16'/>"
+            "</svg>";
+
+    QSvgRenderer renderer(svg);
+    QVERIFY(renderer.isValid());
+
+    const QImage image = renderToImage(renderer, QSize(32, 32));
+    for (const QPoint &pos : { QPoint(8, 8), QPoint(24, 24) }) {
+        QVERIFY(qAbs(qGray(image.pixel(pos)) - 128) < 16);
+        QCOMPARE(qAlpha(image.pixel(pos)), 255);
+    }
+    QCOMPARE(image.pixel(24, 8), qRgba(0, 0, 0, 0));
+    QCOMPARE(renderToImage(renderer, QSize(32, 32)), image);
+
+    // On a high-dpi device, the image covers the device pixels of its bounds exactly
+    QImage hidpi(64, 64, QImage::Format_ARGB32_Premultiplied);
+    hidpi.setDevicePixelRatio(2);
+    hidpi.fill(Qt::transparent);
+    QPainter p(&hidpi);
+    renderer.render(&p, QRectF(0, 0, 32, 32));
+    p.end();
+    for (const QPoint &pos : { QPoint(1, 1), QPoint(30, 30), QPoint(33, 33), QPoint(62, 62) }) {
+        QVERIFY(qAbs(qGray(hidpi.pixel(pos)) - 128) < 16);
+        QCOMPARE(qAlpha(hidpi.pixel(pos)), 255);
+    }
+    QCOMPARE(hidpi.pixel(48, 16), qRgba(0, 0, 0, 0));
+    QCOMPARE(hidpi.pixel(16, 48), qRgba(0, 0, 0, 0));
+}
+
+void tst_QSvgRenderer::imageFormatPinned()
+{
+    // An image file replaced after the document was parsed is only read with the
+    // format detected when parsing
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString imagePath = dir.filePath(u"image.png"_s);
+    QImage img(8, 8, QImage::Format_RGB32);
+    img.fill(Qt::red);
+    QVERIFY(img.save(imagePath, "PNG"));
+
+    QFile svgFile(dir.filePath(u"image.svg"_s));
+    QVERIFY(svgFile.open(QIODevice::WriteOnly));
+    svgFile.write("<svg width='8' height='8'><image xlink:href='image.png' width='8' height='8'/></svg>");
+    svgFile.close();
+
+    QSvgRenderer renderer(svgFile.fileName());
+    QVERIFY(renderer.isValid());
+
+    img.fill(Qt::blue);
+    QVERIFY(img.save(imagePath, "BMP"));
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Could not decode image"));
+    QCOMPARE(renderToImage(renderer, QSize(8, 8)).pixel(4, 4), qRgba(0, 0, 0, 0));
+}
+
 void tst_QSvgRenderer::illegalAnimateTransform_data()
 {
     QTest::addColumn<QByteArray>("svg");
@@ -1894,7 +2149,142 @@ void tst_QSvgRenderer::testMaskElement()
     p.drawImage(QRect(0, 0, 240, 240), refMask);
     p.end();
 
-    QCOMPARE(refImage, image);
+    // The mask luminance is computed in 8 bit fixed point, which may be off by one
+    int maxDifference = 0;
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            const QRgb a = image.pixel(x, y);
+            const QRgb b = refImage.pixel(x, y);
+            maxDifference = qMax(maxDifference, qAbs(qRed(a) - qRed(b)));
+            maxDifference = qMax(maxDifference, qAbs(qGreen(a) - qGreen(b)));
+            maxDifference = qMax(maxDifference, qAbs(qBlue(a) - qBlue(b)));
+            maxDifference = qMax(maxDifference, qAbs(qAlpha(a) - qAlpha(b)));
+        }
+    }
+    QCOMPARE_LE(maxDifference, 1);
+}
+
+void tst_QSvgRenderer::testClipPath()
+{
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <clipPath id="rectClip">
+                      <rect x="20" y="20" width="40" height="40"/>
+                      </clipPath>
+                      <clipPath id="circleClip" clipPathUnits="objectBoundingBox" clip-rule="evenodd">
+                      <path d="M 0 0 h 1 v 1 h -1 z M 0.25 0.25 h 0.5 v 0.5 h -0.5 z"/>
+                      </clipPath>
+                      <rect width="100" height="50" fill="red" clip-path="url(#rectClip)"/>
+                      <rect x="0" y="60" width="40" height="40" fill="blue" clip-path="url(#circleClip)"/>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter p;
+    p.begin(&image);
+    renderer.render(&p);
+    p.end();
+
+    // The rectangular clip is the intersection with the element
+    QCOMPARE(image.pixel(19, 30), qRgba(0, 0, 0, 0));
+    QCOMPARE(image.pixel(20, 20), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(59, 49), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(40, 55), qRgba(0, 0, 0, 0));
+
+    // The bounding box clip with evenodd leaves a hole in the middle
+    QCOMPARE(image.pixel(5, 65), qRgb(0, 0, 255));
+    QCOMPARE(image.pixel(20, 80), qRgba(0, 0, 0, 0));
+    QCOMPARE(image.pixel(35, 95), qRgb(0, 0, 255));
+
+    // Content without a geometric outline leaves the element unclipped, with a warning
+    QByteArray textClipDoc(R"(<svg width="100" height="100">
+                           <clipPath id="textClip">
+                           <rect width="20" height="20"/>
+                           <text x="10" y="50" font-size="40">A</text>
+                           </clipPath>
+                           <rect width="100" height="100" fill="red" clip-path="url(#textClip)"/>
+                           </svg>)");
+    {
+        SvgLog log("qt.svg.draw");
+        const QImage unclipped = renderToImage(textClipDoc, QSize(100, 100));
+        QCOMPARE(unclipped.pixel(90, 90), qRgb(255, 0, 0));
+        QCOMPARE(log.count(QStringLiteral("Clip path")), 1);
+    }
+
+    // The clip region follows the animations of the clip path content
+    QByteArray animatedDoc(R"(<svg width="100" height="100">
+                           <clipPath id="clip">
+                           <rect width="20" height="100">
+                           <animateTransform attributeName="transform" type="translate" from="0 0" to="100 0"
+                                             begin="0s" dur="10s" end="10s"/>
+                           </rect>
+                           </clipPath>
+                           <rect width="100" height="100" fill="red" clip-path="url(#clip)"/>
+                           </svg>)");
+
+    QSvgRenderer animatedRenderer(animatedDoc);
+    QVERIFY(animatedRenderer.animated());
+    image = renderToImage(animatedRenderer, QSize(100, 100));
+    QCOMPARE(image.pixel(5, 50), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(55, 50), qRgba(0, 0, 0, 0));
+    animatedRenderer.setCurrentFrame(animatedRenderer.framesPerSecond() * 5);
+    image = renderToImage(animatedRenderer, QSize(100, 100));
+    QCOMPARE(image.pixel(5, 50), qRgba(0, 0, 0, 0));
+    QCOMPARE(image.pixel(55, 50), qRgb(255, 0, 0));
+}
+
+void tst_QSvgRenderer::testBinaryMask()
+{
+    // A mask of opaque white shapes is equivalent to a clip path
+    QByteArray maskDoc(R"(<svg width="100" height="100">
+                       <mask id="mask" maskUnits="userSpaceOnUse" x="0" y="0" width="100" height="100">
+                       <rect x="10" y="10" width="30" height="60" fill="#ffffff"/>
+                       </mask>
+                       <circle cx="50" cy="50" r="45" fill="green" mask="url(#mask)"/>
+                       </svg>)");
+    QByteArray clipDoc(R"(<svg width="100" height="100">
+                       <clipPath id="clip">
+                       <rect x="10" y="10" width="30" height="60"/>
+                       </clipPath>
+                       <circle cx="50" cy="50" r="45" fill="green" clip-path="url(#clip)"/>
+                       </svg>)");
+
+    const QImage masked = renderToImage(maskDoc, QSize(100, 100));
+    QCOMPARE(masked, renderToImage(clipDoc, QSize(100, 100)));
+    QCOMPARE(masked.pixel(25, 40), qRgb(0, 128, 0));
+    QCOMPARE(masked.pixel(45, 40), qRgba(0, 0, 0, 0));
+}
+
+void tst_QSvgRenderer::testGrayscaleMask()
+{
+    // Gray mask content is rendered into a single channel buffer. The color mask
+    // differs only by an invisible red rect, which needs a full color buffer.
+    const QByteArray maskTemplate(R"(<svg width="100" height="100">
+                                  <defs>
+                                  <linearGradient id="gradient">
+                                  <stop offset="0" stop-color="white"/>
+                                  <stop offset="1" stop-color="#202020"/>
+                                  </linearGradient>
+                                  </defs>
+                                  <mask id="mask" maskUnits="userSpaceOnUse" x="0" y="0" width="100" height="100">
+                                  <circle cx="50" cy="50" r="40" fill="url(#gradient)"/>
+                                  <rect x="10" y="10" width="20" height="20" fill="#404040"/>
+                                  %1
+                                  </mask>
+                                  <rect width="100" height="100" fill="green" mask="url(#mask)"/>
+                                  </svg>)");
+
+    const QImage grayscale = renderToImage(QString::fromLatin1(maskTemplate).arg(QString()).toLatin1(),
+                                           QSize(100, 100));
+    const QImage color = renderToImage(QString::fromLatin1(maskTemplate)
+                                       .arg(QLatin1String(R"(<rect width="5" height="5" fill="red" fill-opacity="0"/>)"))
+                                       .toLatin1(),
+                                       QSize(100, 100));
+    QCOMPARE(grayscale, color);
+    QCOMPARE(grayscale.pixel(95, 95), qRgba(0, 0, 0, 0));
+    QCOMPARE(qAlpha(grayscale.pixel(12, 12)), 64);
 }
 
 void tst_QSvgRenderer::testSymbol()
@@ -1961,6 +2351,450 @@ void tst_QSvgRenderer::testMarker()
     QCOMPARE(refImage, image);
 }
 
+void tst_QSvgRenderer::testMarkerSprites()
+{
+    // With optimizeSpeed, markers repeated along a shape are blitted from sprites kept
+    // in the document. Unrotated at whole pixel positions, they match drawing each marker,
+    // and rotated markers are drawn directly.
+    // A path snaking through a 10x10 grid of vertices
+    QByteArray path;
+    for (int row = 0; row < 10; ++row) {
+        for (int column = 0; column < 10; ++column) {
+            const int x = 5 + 10 * (row % 2 ? 9 - column : column);
+            path += (path.isEmpty() ? "M" : " L") + QByteArray::number(x) + ' '
+                    + QByteArray::number(5 + 10 * row);
+        }
+    }
+    const QByteArray svgTemplate(R"(<svg width="100" height="100" image-rendering="%1">
+                                 <marker id="mark" markerWidth="4" markerHeight="4" refX="2" refY="2"
+                                 orient="auto" markerUnits="userSpaceOnUse">
+                                 <rect width="4" height="4" fill="red"/>
+                                 </marker>
+                                 <path d="%2" fill="none" marker-mid="url(#mark)"/>
+                                 </svg>)");
+    auto document = [&](const char *imageRendering) {
+        return QByteArray(svgTemplate).replace("%1", imageRendering).replace("%2", path);
+    };
+
+    QSvgRenderer renderer(document("optimizeSpeed"));
+    QVERIFY(renderer.isValid());
+    const QImage sprites = renderToImage(renderer, QSize(100, 100));
+    const QImage reference = renderToImage(document("optimizeQuality"), QSize(100, 100));
+    QCOMPARE(sprites, reference);
+
+    QCOMPARE(sprites.pixel(35, 5), qRgb(255, 0, 0));
+    QCOMPARE(sprites.pixel(35, 55), qRgb(255, 0, 0));
+    QCOMPARE(sprites.pixel(10, 10), qRgba(0, 0, 0, 0));
+
+    // Rendering again blits the cached sprites
+    QCOMPARE(renderToImage(renderer, QSize(100, 100)), reference);
+}
+
+void tst_QSvgRenderer::testTextLayoutCache()
+{
+    // The same text instantiated with different inherited fills is laid out for each
+    const QByteArray svgDoc(R"(<svg width="100" height="100">
+                            <defs><text id="label" x="5" y="30" font-size="30">MM</text></defs>
+                            <use href="#label" fill="red"/>
+                            <use href="#label" y="50" fill="blue"/>
+                            </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    const QImage image = renderToImage(renderer, QSize(100, 100));
+    bool hasRed = false;
+    bool hasBlue = false;
+    for (int y = 0; y < 50; ++y) {
+        for (int x = 0; x < 100; ++x) {
+            hasRed |= image.pixel(x, y) == qRgb(255, 0, 0);
+            hasBlue |= image.pixel(x, y + 50) == qRgb(0, 0, 255);
+            QCOMPARE(qBlue(image.pixel(x, y)), 0);
+            QCOMPARE(qRed(image.pixel(x, y + 50)), 0);
+        }
+    }
+    QVERIFY(hasRed);
+    QVERIFY(hasBlue);
+
+    const QRectF bounds = renderer.boundsOnElement(QStringLiteral("label"));
+    QVERIFY(!bounds.isEmpty());
+    QCOMPARE(renderToImage(renderer, QSize(100, 100)), image);
+    QCOMPARE(renderer.boundsOnElement(QStringLiteral("label")), bounds);
+
+    // Text painted again with the same style reuses its layout, for painting as well
+    // as for the bounds
+    QSvgRenderer single(QByteArray(R"(<svg width="100" height="50">
+                                   <text id="single" x="5" y="30" font-size="30" fill="red">MM</text>
+                                   </svg>)"));
+    QVERIFY(single.isValid());
+    const QRectF singleBounds = single.boundsOnElement(u"single"_s);
+    QVERIFY(!singleBounds.isEmpty());
+    const QImage first = renderToImage(single, QSize(100, 50));
+    QCOMPARE(single.boundsOnElement(u"single"_s), singleBounds);
+    QCOMPARE(renderToImage(single, QSize(100, 50)), first);
+    QCOMPARE(single.boundsOnElement(u"single"_s), singleBounds);
+}
+
+void tst_QSvgRenderer::testSvgFontGlyphs()
+{
+    // Glyphs for characters outside the BMP and for ligatures, which take precedence
+    // over the glyphs of their single characters
+    const QByteArray svgDoc(R"(<svg width="40" height="20">
+                            <defs><font horiz-adv-x="10">
+                            <font-face font-family="Glyphs" units-per-em="10"/>
+                            <glyph unicode="A" d="M0 0 H10 V10 H0 Z"/>
+                            <glyph unicode="&#x1F600;" d="M0 5 H10 V10 H0 Z"/>
+                            <glyph unicode="f" d="M0 0 H10 V10 H0 Z"/>
+                            <glyph unicode="i" d="M0 0 H10 V10 H0 Z"/>
+                            <glyph unicode="fi" d="M0 0 H10 V5 H0 Z"/>
+                            </font></defs>
+                            <text x="0" y="10" font-family="Glyphs" font-size="10">A&#x1F600;fi</text>
+                            </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    QImage image(40, 20, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter p(&image);
+    renderer.render(&p);
+    p.end();
+
+    QCOMPARE(qAlpha(image.pixel(5, 5)), 255);
+    QCOMPARE(qAlpha(image.pixel(15, 2)), 255);
+    QCOMPARE(qAlpha(image.pixel(15, 8)), 0);
+    QCOMPARE(qAlpha(image.pixel(25, 8)), 255);
+    QCOMPARE(qAlpha(image.pixel(25, 2)), 0);
+    QCOMPARE(qAlpha(image.pixel(35, 5)), 0);
+
+    // Overlapping glyphs with a translucent fill blend where they overlap, as if each
+    // was drawn on its own
+    const QByteArray overlapDoc(R"(<svg width="20" height="10">
+                                <defs><font horiz-adv-x="5">
+                                <font-face font-family="Overlap" units-per-em="10"/>
+                                <glyph unicode="O" d="M0 0 H10 V10 H0 Z"/>
+                                </font></defs>
+                                <text x="0" y="10" font-family="Overlap" font-size="10"
+                                fill="black" fill-opacity="0.5">OO</text>
+                                </svg>)");
+    const QImage overlap = renderToImage(overlapDoc, QSize(20, 10));
+    QVERIFY(qAbs(qAlpha(overlap.pixel(2, 5)) - 128) <= 2);
+    QVERIFY(qAbs(qAlpha(overlap.pixel(7, 5)) - 191) <= 2);
+    QVERIFY(qAbs(qAlpha(overlap.pixel(12, 5)) - 128) <= 2);
+
+    // The same holds for strokes, which overlap although the glyphs do not
+    const QByteArray strokeDoc(R"(<svg width="30" height="20">
+                               <defs><font horiz-adv-x="12">
+                               <font-face font-family="Stroked" units-per-em="10"/>
+                               <glyph unicode="O" d="M0 0 H10 V10 H0 Z"/>
+                               </font></defs>
+                               <text x="0" y="15" font-family="Stroked" font-size="10" fill="none"
+                               stroke="black" stroke-width="4" stroke-opacity="0.5">OO</text>
+                               </svg>)");
+    const QImage stroked = renderToImage(strokeDoc, QSize(30, 20));
+    QVERIFY(qAbs(qAlpha(stroked.pixel(9, 10)) - 128) <= 2);
+    QVERIFY(qAbs(qAlpha(stroked.pixel(11, 10)) - 191) <= 2);
+    QVERIFY(qAbs(qAlpha(stroked.pixel(13, 10)) - 128) <= 2);
+}
+
+void tst_QSvgRenderer::testTextAsPaths()
+{
+    // Text converted to paths covers about the same area as text drawn through the font
+    // engine, and keeps the colors of its spans
+    const QByteArray svgDoc(R"(<svg width="200" height="60">
+                            <text x="5" y="40" font-size="30" fill="red">MMM<tspan fill="blue">MMM</tspan></text>
+                            </svg>)");
+
+    auto renderWithOptions = [&](QtSvg::Options options) {
+        QSvgRenderer renderer;
+        renderer.setOptions(options);
+        renderer.load(svgDoc);
+        return renderToImage(renderer, QSize(200, 60));
+    };
+
+    auto coverage = [](const QImage &image, QRgb color) {
+        int count = 0;
+        for (int y = 0; y < image.height(); ++y) {
+            for (int x = 0; x < image.width(); ++x)
+                count += image.pixel(x, y) == color;
+        }
+        return count;
+    };
+
+    const QImage text = renderWithOptions({});
+    const QImage paths = renderWithOptions(QtSvg::TextAsPaths);
+    for (QRgb color : { qRgb(255, 0, 0), qRgb(0, 0, 255) }) {
+        const int textCoverage = coverage(text, color);
+        const int pathCoverage = coverage(paths, color);
+        QVERIFY(textCoverage > 0);
+        QVERIFY(pathCoverage > textCoverage * 0.8);
+        QVERIFY(pathCoverage < textCoverage * 1.25);
+    }
+
+    // Decorations of the painter font are drawn in both modes; M has no descender,
+    // so anything below the baseline is the underline
+    auto renderUnderlined = [&](QtSvg::Options options, bool underline) {
+        QSvgRenderer renderer;
+        renderer.setOptions(options);
+        renderer.load(svgDoc);
+        QImage image(200, 60, QImage::Format_RGB32);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        QFont font = painter.font();
+        font.setUnderline(underline);
+        painter.setFont(font);
+        renderer.render(&painter);
+        painter.end();
+        return image;
+    };
+
+    auto belowBaseline = [](const QImage &image) {
+        int count = 0;
+        for (int y = 42; y < image.height(); ++y) {
+            for (int x = 0; x < image.width(); ++x)
+                count += image.pixel(x, y) != qRgb(255, 255, 255);
+        }
+        return count;
+    };
+
+    QCOMPARE(belowBaseline(renderUnderlined(QtSvg::TextAsPaths, false)), 0);
+    const int textUnderline = belowBaseline(renderUnderlined({}, true));
+    const int pathUnderline = belowBaseline(renderUnderlined(QtSvg::TextAsPaths, true));
+    QVERIFY(textUnderline > 0);
+    QVERIFY(pathUnderline > textUnderline / 2);
+    QVERIFY(pathUnderline < textUnderline * 2);
+}
+
+void tst_QSvgRenderer::testStyleStateRestored()
+{
+    // Styles shared through nested <use> elements are applied re-entrantly, and
+    // everything they change has to be restored for the following siblings
+    const QByteArray svgDoc(R"(<svg width="40" height="20">
+                            <defs>
+                              <g id="a" transform="translate(5,0)" opacity="0.5" fill="blue">
+                                <rect width="5" height="5"/>
+                              </g>
+                              <g id="b" font-size="20"><use href="#a"/><use href="#a" y="10"/></g>
+                            </defs>
+                            <g fill="lime" transform="translate(20,0)"><use href="#b"/></g>
+                            <rect x="0" y="15" width="5" height="5"/>
+                            </svg>)");
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    QImage image(40, 20, QImage::Format_ARGB32);
+    image.fill(Qt::white);
+    QPainter p(&image);
+    renderer.render(&p);
+    p.end();
+
+    const QRgb halfBlue = qRgb(127, 127, 255);
+    QVERIFY(qAbs(qBlue(image.pixel(27, 2)) - qBlue(halfBlue)) <= 1);
+    QVERIFY(qAbs(qRed(image.pixel(27, 2)) - qRed(halfBlue)) <= 1);
+    QCOMPARE(image.pixel(27, 12), image.pixel(27, 2));
+    QCOMPARE(image.pixel(2, 2), qRgb(255, 255, 255));
+    QCOMPARE(image.pixel(2, 17), qRgb(0, 0, 0));
+}
+
+void tst_QSvgRenderer::testSharedStyleProperties()
+{
+    // Identical attributes share one style property, but currentColor
+    // still resolves to the color of each element's context
+    const QByteArray svgDoc(R"(<svg width="20" height="10">
+                            <g color="red"><rect width="5" height="5" fill="currentColor"/></g>
+                            <g color="blue"><rect x="10" width="5" height="5" fill="currentColor"/></g>
+                            <rect y="5" width="5" height="5" fill="lime" fill-opacity="0.5"/>
+                            <rect x="10" y="5" width="5" height="5" fill="lime" fill-opacity="0.5"/>
+                            </svg>)");
+    SvgLog log("qt.svg");
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+    QCOMPARE(log.count(u"Created 1 shared style properties for 2 elements"_s), 1);
+
+    const QImage image = renderToImage(renderer, QSize(20, 10), Qt::white);
+
+    QCOMPARE(image.pixel(2, 2), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(12, 2), qRgb(0, 0, 255));
+    QCOMPARE(image.pixel(12, 7), image.pixel(2, 7));
+    QVERIFY(qAbs(qRed(image.pixel(2, 7)) - 127) <= 1);
+    QCOMPARE(qGreen(image.pixel(2, 7)), 255);
+}
+
+void tst_QSvgRenderer::testCssRuleIndex()
+{
+    // Rules bucketed by id, class and element name keep their cascade order, also
+    // between rules of equal specificity in different buckets
+    const QByteArray svgDoc(R"(<svg width="50" height="10">
+                            <style>rect { fill: red } .a { fill: lime } #c { fill: blue }</style>
+                            <style>.b.a { fill: yellow } g > .d, .e { fill: black }</style>
+                            <style>rect.x { fill: red } g .x { fill: blue } g .y { fill: red } rect.y { fill: lime }</style>
+                            <rect width="5" height="5"/>
+                            <rect x="10" width="5" height="5" class="a"/>
+                            <rect x="20" width="5" height="5" class="a b" id="c"/>
+                            <rect x="30" width="5" height="5" class="b  a a"/>
+                            <g><rect x="40" width="5" height="5" class="d"/></g>
+                            <g><rect y="5" width="5" height="5" class="x"/></g>
+                            <g><rect x="10" y="5" width="5" height="5" class="y"/></g>
+                            </svg>)");
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    const QImage image = renderToImage(renderer, QSize(50, 10), Qt::white);
+    QCOMPARE(image.pixel(2, 2), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(12, 2), qRgb(0, 255, 0));
+    QCOMPARE(image.pixel(22, 2), qRgb(0, 0, 255));
+    QCOMPARE(image.pixel(32, 2), qRgb(255, 255, 0));
+    QCOMPARE(image.pixel(42, 2), qRgb(0, 0, 0));
+    QCOMPARE(image.pixel(2, 7), qRgb(0, 0, 255));
+    QCOMPARE(image.pixel(12, 7), qRgb(0, 255, 0));
+}
+
+void tst_QSvgRenderer::testColorParsing_data()
+{
+    QTest::addColumn<QByteArray>("color");
+    QTest::addColumn<QRgb>("expected");
+
+    // Invalid colors leave the default black fill in place
+    const QRgb invalid = qRgb(0, 0, 0);
+    QTest::newRow("hex3") << "#f80"_ba << qRgb(0xff, 0x88, 0x00);
+    QTest::newRow("hex6") << "#1A2b3C"_ba << qRgb(0x1a, 0x2b, 0x3c);
+    QTest::newRow("hex9") << "#123456789"_ba << qRgb(0x12, 0x45, 0x78);
+    QTest::newRow("hex12") << "#1234abcd5678"_ba << qRgb(0x12, 0xab, 0x56);
+    QTest::newRow("hex-spaces") << "  #00ff00 "_ba << qRgb(0, 255, 0);
+    QTest::newRow("hex-invalid-digit") << "#12345g"_ba << invalid;
+    QTest::newRow("hex-invalid-length") << "#1234"_ba << invalid;
+    QTest::newRow("hex-non-latin1") << "#1234\xc5\x81"_ba << invalid;
+    QTest::newRow("rgb") << "rgb(10, 20,30)"_ba << qRgb(10, 20, 30);
+    QTest::newRow("rgb-percent") << "rgb(100%, 0%, 50%)"_ba << qRgb(255, 0, 127);
+    QTest::newRow("named") << "cornflowerblue"_ba << qRgb(100, 149, 237);
+    QTest::newRow("named-mixed-case") << "DarkOrange"_ba << qRgb(255, 140, 0);
+    QTest::newRow("named-unknown") << "notacolor"_ba << invalid;
+}
+
+void tst_QSvgRenderer::testColorParsing()
+{
+    QFETCH(QByteArray, color);
+    QFETCH(QRgb, expected);
+
+    const QByteArray svgDoc = R"(<svg width="10" height="10"><rect width="10" height="10" fill=")"
+            + color + R"("/></svg>)";
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    QImage image(10, 10, QImage::Format_ARGB32);
+    image.fill(Qt::white);
+    QPainter p(&image);
+    renderer.render(&p);
+    p.end();
+
+    QCOMPARE(image.pixel(5, 5), expected);
+}
+
+void tst_QSvgRenderer::testTransformParsing_data()
+{
+    QTest::addColumn<QByteArray>("transform");
+    QTest::addColumn<QTransform>("expected");
+
+    QTest::newRow("translate") << "translate(10, -5)"_ba << QTransform::fromTranslate(10, -5);
+    QTest::newRow("translate-x") << "translate(7)"_ba << QTransform::fromTranslate(7, 0);
+    QTest::newRow("identity") << "translate(0) scale(1)"_ba << QTransform();
+    QTest::newRow("rotate-right-angle") << "rotate(90)"_ba << QTransform().rotate(90);
+    QTest::newRow("rotate-around") << "rotate(30 5 8)"_ba
+                                   << QTransform().translate(5, 8).rotate(30).translate(-5, -8);
+    QTest::newRow("scale-skew") << "scale(2,3) skewX(20) skewY(-10)"_ba
+                                << QTransform().scale(2, 3).shear(qTan(qDegreesToRadians(20.)), 0)
+                                               .shear(0, qTan(qDegreesToRadians(-10.)));
+    QTest::newRow("list") << "matrix(1 2 3 4 5 6),translate(1,2) rotate(45)"_ba
+                          << QTransform(1, 2, 3, 4, 5, 6).translate(1, 2).rotate(45);
+    QTest::newRow("error-keeps-prefix") << "translate(3,4) scale(1,2,3) rotate(45)"_ba
+                                        << QTransform::fromTranslate(3, 4);
+}
+
+void tst_QSvgRenderer::testTransformParsing()
+{
+    QFETCH(QByteArray, transform);
+    QFETCH(QTransform, expected);
+
+    const QByteArray svgDoc = R"(<svg><g transform=")" + transform
+            + R"("><rect id="r" width="1" height="1"/></g></svg>)";
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+    compareTransforms(renderer.transformForElement("r"_L1), expected);
+}
+
+void tst_QSvgRenderer::testNoOpStyleProperties()
+{
+    // No-op properties are left out of the style, but still override earlier values.
+    // Explicit source-over is kept, as it resets a composition mode set by an ancestor,
+    // also when the element is instantiated through <use>.
+    const QByteArray svgDoc(R"(<svg width="40" height="10">
+                            <style>#a { opacity: 0.5 }</style>
+                            <defs><rect id="d" x="30" width="5" height="5" fill="red" comp-op="src-over"/></defs>
+                            <rect id="a" width="5" height="5" fill="blue" opacity="1"/>
+                            <g comp-op="clear"><rect x="10" width="5" height="5" fill="red" comp-op="src-over"/></g>
+                            <rect x="20" width="5" height="5" fill="lime" transform="translate(0,0)"/>
+                            <g comp-op="clear"><use href="#d"/></g>
+                            </svg>)");
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    const QImage image = renderToImage(renderer, QSize(40, 10), Qt::white);
+    QCOMPARE(image.pixel(2, 2), qRgb(0, 0, 255));
+    QCOMPARE(image.pixel(12, 2), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(22, 2), qRgb(0, 255, 0));
+    QCOMPARE(image.pixel(32, 2), qRgb(255, 0, 0));
+
+    // Drawing with no-op properties touches the painter as often as drawing without
+    auto painterUpdates = [](const QByteArray &doc) {
+        QSvgRenderer renderer(doc);
+        SvgLog log("qt.svg.draw");
+        renderToImage(renderer, QSize(10, 10));
+        return log.messages().filter(u"Painter state updates"_s);
+    };
+    const QStringList plain = painterUpdates(R"(<svg width="10" height="10">
+                                             <rect width="5" height="5" fill="blue"/>
+                                             </svg>)");
+    QCOMPARE(plain.size(), 1);
+    QCOMPARE(painterUpdates(R"(<svg width="10" height="10">
+                            <rect width="5" height="5" fill="blue" opacity="1" transform="translate(0,0)"/>
+                            </svg>)"), plain);
+}
+
+void tst_QSvgRenderer::testPainterStateTracking()
+{
+    // Restoring a font or transform that is already in place is skipped and counted,
+    // both when rendering the whole document and a single element
+    const QByteArray svgDoc(R"(<svg width="20" height="10">
+                            <g id="g" font-family="Arial" font-size="10">
+                            <rect width="5" height="5" fill="red" font-size="10"/>
+                            <rect width="5" height="5" fill="red" transform="translate(10,0)"/>
+                            </g>
+                            </svg>)");
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    const QRegularExpression updates(u"^Painter state updates: [1-9]\\d* issued, [1-9]\\d* elided"_s);
+    QImage image;
+    {
+        SvgLog log("qt.svg.draw");
+        image = renderToImage(renderer, QSize(20, 10), Qt::white);
+        QCOMPARE(log.messages().size(), 1);
+        QVERIFY(updates.match(log.messages().constFirst()).hasMatch());
+    }
+    QCOMPARE(image.pixel(2, 2), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(12, 2), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(7, 2), qRgb(255, 255, 255));
+
+    SvgLog log("qt.svg.draw");
+    QImage element(20, 10, QImage::Format_ARGB32_Premultiplied);
+    element.fill(Qt::white);
+    QPainter p(&element);
+    renderer.render(&p, u"g"_s, QRectF(0, 0, 20, 10));
+    p.end();
+    QCOMPARE(log.messages().size(), 1);
+    QVERIFY(updates.match(log.messages().constFirst()).hasMatch());
+}
+
 void tst_QSvgRenderer::tSpanLineBreak()
 {
     QSvgRenderer renderer;
@@ -2068,6 +2902,32 @@ void tst_QSvgRenderer::testPatternElement()
     QCOMPARE(refImage, image);
 }
 
+void tst_QSvgRenderer::testPatternTileFormat()
+{
+    // A tile size that is integral up to precision errors (100 * 0.07) is not rounded
+    // up, so the tile maps to device pixels 1:1 instead of being resampled
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <pattern id="pattern" width="0.07" height="0.07">
+                      <rect width="3" height="7" fill="red"/>
+                      <rect x="3" width="4" height="7" fill="blue" fill-opacity="0.5"/>
+                      </pattern>
+                      <rect width="100" height="100" fill="url(#pattern)"/>
+                      </svg>)");
+
+    const QImage image = renderToImage(svgDoc, QSize(100, 100));
+    for (int x = 0; x < 98; ++x) {
+        const QRgb pixel = image.pixel(x, 50);
+        if (x % 7 < 3) {
+            QCOMPARE(pixel, qRgba(255, 0, 0, 255));
+        } else {
+            // Semi-transparent content keeps its color in the premultiplied tile
+            QCOMPARE(qRed(pixel), 0);
+            QCOMPARE(qBlue(pixel), 255);
+            QVERIFY(qAbs(qAlpha(pixel) - 128) <= 1);
+        }
+    }
+}
+
 void tst_QSvgRenderer::testCycles()
 {
     QByteArray svgDoc(R"(<svg viewBox="0 0 200 200">
@@ -2265,6 +3125,38 @@ void tst_QSvgRenderer::testFeGaussian()
 
 }
 
+void tst_QSvgRenderer::testFeGaussianOptimizeSpeed()
+{
+    const QByteArray svgTemplate(R"(<svg width="200" height="200">
+                                 <filter id="f1" x="-50%" y="-50%" width="200%" height="200%">
+                                 <feGaussianBlur in="SourceGraphic" stdDeviation="20"/>
+                                 </filter>
+                                 <rect x="50" y="50" width="100" height="100" fill="blue"
+                                       image-rendering="%1" filter="url(#f1)"/>
+                                 </svg>)");
+
+    // Large blurs are computed at a reduced resolution when speed is preferred,
+    // which must stay visually equivalent to the full resolution blur
+    const QImage quality = renderToImage(QByteArray(svgTemplate).replace("%1", "optimizeQuality"),
+                                         QSize(200, 200), Qt::white);
+    const QImage speed = renderToImage(QByteArray(svgTemplate).replace("%1", "optimizeSpeed"),
+                                       QSize(200, 200), Qt::white);
+
+    QCOMPARE(speed.size(), quality.size());
+    int maxDifference = 0;
+    for (int y = 0; y < quality.height(); ++y) {
+        for (int x = 0; x < quality.width(); ++x) {
+            const QRgb a = quality.pixel(x, y);
+            const QRgb b = speed.pixel(x, y);
+            maxDifference = qMax(maxDifference, qAbs(qRed(a) - qRed(b)));
+            maxDifference = qMax(maxDifference, qAbs(qGreen(a) - qGreen(b)));
+            maxDifference = qMax(maxDifference, qAbs(qBlue(a) - qBlue(b)));
+        }
+    }
+    QCOMPARE_LE(maxDifference, 8);
+    QCOMPARE_LE(qRed(speed.pixel(100, 100)), 30);
+}
+
 void tst_QSvgRenderer::testFeBlend()
 {
     QByteArray svgDoc(R"(<svg width="50" height="50">
@@ -2296,5 +3188,469 @@ void tst_QSvgRenderer::testFeBlend()
     QCOMPARE(refImage, image);
 }
 
+void tst_QSvgRenderer::testFeMorphology()
+{
+    QByteArray svgDoc(R"(<svg width="50" height="100">
+                      <filter id="dilate">
+                      <feMorphology operator="dilate" radius="2"/>
+                      </filter>
+                      <filter id="erode">
+                      <feMorphology operator="erode" radius="2 4"/>
+                      </filter>
+                      <rect x="10" y="10" width="30" height="30" fill="blue" filter="url(#dilate)"/>
+                      <rect x="10" y="60" width="30" height="30" fill="blue" filter="url(#erode)"/>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    QImage image(50, 100, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QImage refImage(50, 100, QImage::Format_ARGB32_Premultiplied);
+    refImage.fill(Qt::transparent);
+
+    QPainter p;
+    p.begin(&image);
+    renderer.render(&p);
+    p.end();
+
+    p.begin(&refImage);
+    p.fillRect(8, 8, 34, 34, Qt::blue);
+    p.fillRect(12, 64, 26, 22, Qt::blue);
+    p.end();
+
+    QCOMPARE(refImage, image);
+}
+
+void tst_QSvgRenderer::testFeConvolveMatrix()
+{
+    QByteArray svgDoc(R"(<svg width="50" height="100">
+                      <filter id="identity">
+                      <feConvolveMatrix order="3" kernelMatrix="0 0 0 0 1 0 0 0 0"/>
+                      </filter>
+                      <filter id="shift">
+                      <feConvolveMatrix order="3" kernelMatrix="1 0 0 0 0 0 0 0 0"/>
+                      </filter>
+                      <rect x="10" y="10" width="30" height="30" fill="blue" filter="url(#identity)"/>
+                      <rect x="10" y="60" width="30" height="30" fill="blue" filter="url(#shift)"/>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    QImage image(50, 100, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QImage refImage(50, 100, QImage::Format_ARGB32_Premultiplied);
+    refImage.fill(Qt::transparent);
+
+    QPainter p;
+    p.begin(&image);
+    renderer.render(&p);
+    p.end();
+
+    // The kernel is rotated by 180 degrees, so a weight in the top left
+    // corner picks up the pixel to the bottom right.
+    p.begin(&refImage);
+    p.fillRect(10, 10, 30, 30, Qt::blue);
+    p.fillRect(9, 59, 30, 30, Qt::blue);
+    p.end();
+
+    QCOMPARE(refImage, image);
+}
+
+void tst_QSvgRenderer::testFeTurbulence()
+{
+    QByteArray flatDoc(R"(<svg width="50" height="50">
+                       <filter id="f1" x="0" y="0" width="1" height="1">
+                       <feTurbulence type="fractalNoise" baseFrequency="0"/>
+                       </filter>
+                       <rect x="10" y="10" width="30" height="30" filter="url(#f1)"/>
+                       </svg>)");
+
+    QSvgRenderer flatRenderer(flatDoc);
+    QVERIFY(flatRenderer.isValid());
+
+    QImage flatImage(50, 50, QImage::Format_ARGB32);
+    flatImage.fill(Qt::transparent);
+    QPainter p;
+    p.begin(&flatImage);
+    flatRenderer.render(&p);
+    p.end();
+
+    // Without any frequency, fractal noise is a constant 50% in every channel
+    QCOMPARE(flatImage.pixel(5, 5), qRgba(0, 0, 0, 0));
+    for (int y = 10; y < 40; ++y) {
+        for (int x = 10; x < 40; ++x) {
+            const QRgb pixel = flatImage.pixel(x, y);
+            QVERIFY(qAbs(qAlpha(pixel) - 128) <= 1);
+            QVERIFY(qAbs(qRed(pixel) - 128) <= 2);
+            QCOMPARE(qRed(pixel), qGreen(pixel));
+            QCOMPARE(qRed(pixel), qBlue(pixel));
+        }
+    }
+
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <filter id="f1" x="0" y="0" width="1" height="1">
+                      <feTurbulence baseFrequency="0.05 0.08" numOctaves="3" seed="7" stitchTiles="stitch"/>
+                      </filter>
+                      <rect x="10" y="10" width="80" height="80" filter="url(#f1)"/>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    p.begin(&image);
+    renderer.render(&p);
+    p.end();
+
+    QSet<QRgb> colors;
+    for (int y = 10; y < 90; ++y) {
+        for (int x = 10; x < 90; ++x)
+            colors.insert(image.pixel(x, y));
+    }
+    QVERIFY(colors.size() > 100);
+
+    // Generating only a part of the noise must give the same pixels
+    const QRect tileRect(35, 40, 30, 30);
+    QImage tile(tileRect.size(), QImage::Format_ARGB32_Premultiplied);
+    tile.fill(Qt::transparent);
+    p.begin(&tile);
+    p.translate(-tileRect.topLeft());
+    renderer.render(&p, QRectF(0, 0, 100, 100));
+    p.end();
+
+    QCOMPARE(tile, image.copy(tileRect));
+
+    // Octaves beyond the supported maximum add nothing, but must not overflow the
+    // lattice computations. A fractional seed is truncated toward zero.
+    const QByteArray octavesTemplate(R"(<svg width="100" height="100">
+                                     <filter id="f1" x="0" y="0" width="1" height="1">
+                                     <feTurbulence baseFrequency="0.05" numOctaves="%1" seed="%2"
+                                                   stitchTiles="stitch"/>
+                                     </filter>
+                                     <rect x="10" y="10" width="80" height="80" filter="url(#f1)"/>
+                                     </svg>)");
+    auto octavesDoc = [&](const char *numOctaves, const char *seed) {
+        return QByteArray(octavesTemplate).replace("%1", numOctaves).replace("%2", seed);
+    };
+    const QImage maxOctaves = renderToImage(octavesDoc("24", "7"), QSize(100, 100));
+    QCOMPARE(renderToImage(octavesDoc("1000", "7"), QSize(100, 100)), maxOctaves);
+    const QImage seed6 = renderToImage(octavesDoc("24", "6"), QSize(100, 100));
+    QVERIFY(seed6 != maxOctaves);
+    QCOMPARE(renderToImage(octavesDoc("24", "6.8"), QSize(100, 100)), seed6);
+    QCOMPARE(renderToImage(octavesDoc("24", "-6.8"), QSize(100, 100)),
+             renderToImage(octavesDoc("24", "-6"), QSize(100, 100)));
+}
+
+void tst_QSvgRenderer::testFeDisplacementMap()
+{
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <filter id="f1">
+                      <feFlood flood-color="#ff0000" result="map"/>
+                      <feDisplacementMap in="SourceGraphic" in2="map" scale="20"
+                                         xChannelSelector="R" yChannelSelector="G"/>
+                      </filter>
+                      <rect x="20" y="20" width="30" height="30" fill="blue" filter="url(#f1)"/>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QImage refImage(100, 100, QImage::Format_ARGB32_Premultiplied);
+    refImage.fill(Qt::transparent);
+
+    QPainter p;
+    p.begin(&image);
+    renderer.render(&p);
+    p.end();
+
+    // A full red channel moves the source by scale / 2 to the left, and an
+    // empty green channel by scale / 2 down, clipped to the filter region.
+    p.begin(&refImage);
+    p.fillRect(17, 30, 23, 23, Qt::blue);
+    p.end();
+
+    QCOMPARE(refImage, image);
+}
+
+void tst_QSvgRenderer::testFilterRegionOfInterest()
+{
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <filter id="f1" x="-20%" y="-20%" width="140%" height="140%">
+                      <feFlood flood-color="yellow" result="flood"/>
+                      <feGaussianBlur in="SourceGraphic" stdDeviation="4"/>
+                      <feOffset dx="7" dy="5" result="shadow"/>
+                      <feMerge>
+                      <feMergeNode in="shadow"/>
+                      <feMergeNode in="SourceGraphic"/>
+                      </feMerge>
+                      </filter>
+                      <rect x="20" y="20" width="50" height="50" fill="blue" filter="url(#f1)"/>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    const QRectF bounds(0, 0, 100, 100);
+    const QRect tileRect(30, 45, 40, 40);
+
+    QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter p;
+    p.begin(&image);
+    renderer.render(&p, bounds);
+    p.end();
+
+    // Rendering a tile only processes the part of the filter chain that is visible,
+    // which must not change the result inside that tile
+    QImage tile(tileRect.size(), QImage::Format_ARGB32_Premultiplied);
+    tile.fill(Qt::white);
+    p.begin(&tile);
+    p.translate(-tileRect.topLeft());
+    renderer.render(&p, bounds);
+    p.end();
+
+    QCOMPARE(tile, image.copy(tileRect));
+
+    QImage clippedImage(100, 100, QImage::Format_ARGB32_Premultiplied);
+    clippedImage.fill(Qt::white);
+    p.begin(&clippedImage);
+    p.setClipRect(tileRect);
+    renderer.render(&p, bounds);
+    p.end();
+
+    QCOMPARE(clippedImage.copy(tileRect), image.copy(tileRect));
+    QCOMPARE(clippedImage.pixel(5, 5), QColor(Qt::white).rgb());
+}
+
+void tst_QSvgRenderer::testFilterEmptyPrimitiveOutput()
+{
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <filter id="f1">
+                      <feFlood x="20" y="20" width="10" height="10" flood-color="red"/>
+                      <feOffset dx="0" dy="0"/>
+                      </filter>
+                      <rect x="20" y="20" width="60" height="60" fill="blue" filter="url(#f1)"/>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+
+    const QRectF bounds(0, 0, 100, 100);
+    const QRect tileRect(40, 40, 40, 40);
+
+    QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter p;
+    p.begin(&image);
+    renderer.render(&p, bounds);
+    p.end();
+
+    QImage refImage(100, 100, QImage::Format_ARGB32_Premultiplied);
+    refImage.fill(Qt::white);
+    p.begin(&refImage);
+    p.fillRect(20, 20, 10, 10, Qt::red);
+    p.end();
+
+    QCOMPARE(image, refImage);
+
+    // The flood lies outside of the tile, so it produces nothing there. The offset
+    // must then read a transparent input instead of falling back to the source graphic.
+    QImage tile(tileRect.size(), QImage::Format_ARGB32_Premultiplied);
+    tile.fill(Qt::white);
+    p.begin(&tile);
+    p.translate(-tileRect.topLeft());
+    renderer.render(&p, bounds);
+    p.end();
+
+    QCOMPARE(tile, refImage.copy(tileRect));
+}
+
+void tst_QSvgRenderer::testFilterAnimationCache()
+{
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <filter id="f1">
+                      <feOffset dx="10" dy="0"/>
+                      </filter>
+                      <g filter="url(#f1)">
+                      <rect x="0" y="20" width="30" height="30" fill="red">
+                      <animateColor attributeName="fill" from="red" to="blue" begin="0s" dur="100s" end="100s"/>
+                      </rect>
+                      </g>
+                      <rect x="50" y="20" width="30" height="30" fill="green" filter="url(#f1)">
+                      <animateTransform attributeName="transform" type="translate" from="0 0" to="0 50"
+                                        begin="0s" dur="100s" end="100s"/>
+                      </rect>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+    QVERIFY(renderer.animated());
+
+    // Nothing changes noticeably between the first two frames
+    const QImage first = renderToImage(renderer, QSize(100, 100));
+    QVERIFY(qRed(first.pixel(25, 35)) > 200);
+    QCOMPARE(first.pixel(75, 35), qRgba(0, 128, 0, 255));
+    const QImage second = renderToImage(renderer, QSize(100, 100));
+    QCOMPARE(second.pixel(25, 35), first.pixel(25, 35));
+    QCOMPARE(second.pixel(75, 35), first.pixel(75, 35));
+
+    // Half way through, the color of the first filtered group has changed, and
+    // the second filtered element has moved down
+    renderer.setCurrentFrame(renderer.framesPerSecond() * 50);
+    const QImage third = renderToImage(renderer, QSize(100, 100));
+    QVERIFY(qBlue(third.pixel(25, 35)) > 100);
+    QCOMPARE(third.pixel(75, 35), qRgba(0, 0, 0, 0));
+    QCOMPARE(third.pixel(75, 60), qRgba(0, 128, 0, 255));
+
+    // Instances of the same filtered node share a cache entry, but are only drawn
+    // from it if they inherit the same state
+    QByteArray useDoc(R"(<svg width="100" height="100">
+                      <filter id="f1">
+                      <feOffset dx="0" dy="0"/>
+                      </filter>
+                      <defs>
+                      <rect id="r" width="20" height="20" filter="url(#f1)"/>
+                      </defs>
+                      <use href="#r" fill="red"/>
+                      <use href="#r" x="50" fill="blue"/>
+                      <use href="#r" y="50" fill="red" fill-opacity="0.5"/>
+                      <rect x="90" y="90" width="5" height="5" fill="black">
+                      <animateColor attributeName="fill" from="black" to="white" begin="0s" dur="100s"/>
+                      </rect>
+                      </svg>)");
+
+    QSvgRenderer useRenderer(useDoc);
+    QVERIFY(useRenderer.animated());
+    for (int frame = 0; frame < 2; ++frame) {
+        const QImage image = renderToImage(useRenderer, QSize(100, 100));
+        QCOMPARE(image.pixel(10, 10), qRgba(255, 0, 0, 255));
+        QCOMPARE(image.pixel(60, 10), qRgba(0, 0, 255, 255));
+        QVERIFY(qAbs(qAlpha(image.pixel(10, 60)) - 128) <= 1);
+    }
+
+    // A result is only moved by whole device pixels. A sub-pixel translation filters
+    // again, and must look like a rendering that never had a cached result.
+    QByteArray blurDoc(R"(<svg width="100" height="100">
+                       <filter id="f1">
+                       <feGaussianBlur stdDeviation="2"/>
+                       </filter>
+                       <rect x="20" y="20" width="30" height="30" fill="blue" filter="url(#f1)"/>
+                       <rect x="90" y="90" width="5" height="5" fill="black">
+                       <animateColor attributeName="fill" from="black" to="white" begin="0s" dur="100s"/>
+                       </rect>
+                       </svg>)");
+
+    auto renderAt = [](QSvgRenderer &r, const QPointF &offset) {
+        QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter p(&image);
+        p.translate(offset);
+        r.render(&p);
+        p.end();
+        // Leave out the animated rectangle
+        return image.copy(0, 0, 80, 80);
+    };
+
+    QSvgRenderer blurRenderer(blurDoc);
+    QVERIFY(blurRenderer.animated());
+    renderAt(blurRenderer, QPointF(0, 0));
+    for (const QPointF &offset : { QPointF(3, 2), QPointF(0.5, 0.25) }) {
+        QSvgRenderer uncached(blurDoc);
+        QCOMPARE(renderAt(blurRenderer, offset), renderAt(uncached, offset));
+    }
+}
+
+void tst_QSvgRenderer::testPatternTileCache()
+{
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <pattern id="pattern" patternUnits="userSpaceOnUse" width="10" height="10">
+                      <rect width="5" height="10" fill="red">
+                      <animateColor attributeName="fill" from="red" to="blue" begin="0s" dur="100s" end="100s"/>
+                      </rect>
+                      </pattern>
+                      <rect width="40" height="40" fill="url(#pattern)"/>
+                      <rect width="20" height="20" fill="url(#pattern)" transform="translate(50 50) scale(2)"/>
+                      </svg>)");
+
+    QSvgRenderer renderer(svgDoc);
+    QVERIFY(renderer.isValid());
+    QVERIFY(renderer.animated());
+
+    // Both uses of the pattern get a tile matching their scale
+    const QImage first = renderToImage(renderer, QSize(100, 100));
+    QVERIFY(qRed(first.pixel(2, 2)) > 200);
+    QCOMPARE(first.pixel(7, 2), qRgba(0, 0, 0, 0));
+    QVERIFY(qRed(first.pixel(55, 55)) > 200);
+    QCOMPARE(first.pixel(65, 55), qRgba(0, 0, 0, 0));
+    QCOMPARE(renderToImage(renderer, QSize(100, 100)), first);
+
+    // Animating the pattern content replaces the cached tiles
+    renderer.setCurrentFrame(renderer.framesPerSecond() * 50);
+    const QImage second = renderToImage(renderer, QSize(100, 100));
+    QVERIFY(qBlue(second.pixel(2, 2)) > 100);
+    QVERIFY(qBlue(second.pixel(55, 55)) > 100);
+    QCOMPARE(second.pixel(7, 2), qRgba(0, 0, 0, 0));
+}
+
+void tst_QSvgRenderer::testHighPrecisionFilters()
+{
+    // Scaling down and up again loses most of the precision of 8 bit intermediate buffers
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <filter id="f1" color-interpolation-filters="sRGB">
+                      <feColorMatrix type="matrix"
+                                     values="0.02 0 0 0 0  0 0.02 0 0 0  0 0 0.02 0 0  0 0 0 1 0"/>
+                      <feColorMatrix type="matrix"
+                                     values="50 0 0 0 0  0 50 0 0 0  0 0 50 0 0  0 0 0 1 0"/>
+                      </filter>
+                      <rect x="20" y="20" width="60" height="60" fill="rgb(205,205,205)" filter="url(#f1)"/>
+                      </svg>)");
+
+    auto renderWithOptions = [&](QtSvg::Options options) {
+        QSvgRenderer renderer;
+        renderer.setOptions(options);
+        renderer.load(svgDoc);
+        return renderToImage(renderer, QSize(100, 100));
+    };
+
+    const QImage lowPrecision = renderWithOptions({});
+    QVERIFY(qAbs(qRed(lowPrecision.pixel(50, 50)) - 205) > 2);
+
+    const QImage highPrecision = renderWithOptions(QtSvg::HighPrecisionFilters);
+    QVERIFY(qAbs(qRed(highPrecision.pixel(50, 50)) - 205) <= 1);
+    QCOMPARE(qAlpha(highPrecision.pixel(50, 50)), 255);
+    QCOMPARE(highPrecision.pixel(10, 10), qRgba(0, 0, 0, 0));
+}
+
+void tst_QSvgRenderer::testLinearLightFilters()
+{
+    // Blurring a black and white edge in linear light gives a brighter midpoint
+    QByteArray svgDoc(R"(<svg width="100" height="100">
+                      <filter id="f1">
+                      <feGaussianBlur stdDeviation="10"/>
+                      </filter>
+                      <g filter="url(#f1)">
+                      <rect x="0" y="0" width="50" height="100" fill="black"/>
+                      <rect x="50" y="0" width="50" height="100" fill="white"/>
+                      </g>
+                      </svg>)");
+
+    auto midpoint = [&](QtSvg::Options options) {
+        QSvgRenderer renderer;
+        renderer.setOptions(options);
+        renderer.load(svgDoc);
+        const QImage image = renderToImage(renderer, QSize(100, 100), Qt::white);
+        return (qRed(image.pixel(49, 50)) + qRed(image.pixel(50, 50))) / 2;
+    };
+
+    // Without the option, the filter keeps interpolating in sRGB
+    QVERIFY(qAbs(midpoint({}) - 128) < 10);
+    QVERIFY(qAbs(midpoint(QtSvg::HighPrecisionFilters) - 188) < 10);
+}
+
 QTEST_MAIN(tst_QSvgRenderer)
 #include "tst_qsvgrenderer.moc"
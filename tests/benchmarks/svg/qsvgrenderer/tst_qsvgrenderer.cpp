@@ -3,7 +3,10 @@
 
 #include <qtest.h>
 
+#include <QBuffer>
 #include <QFile>
+#include <QImage>
+#include <QPainter>
 #include <QSvgRenderer>
 
 class tst_QSvgRenderer : public QObject
@@ -21,6 +24,15 @@ public slots:
 private slots:
     void construct();
     void load();
+    void loadRepeatedStyles();
+    void colorParsing_data();
+    void colorParsing();
+    void filters_data();
+    void filters();
+    void patternFill_data();
+    void patternFill();
+    void imageDownscale_data();
+    void imageDownscale();
 };
 
 tst_QSvgRenderer::tst_QSvgRenderer()
@@ -59,5 +71,192 @@ void tst_QSvgRenderer::load()
     }
 }
 
+void tst_QSvgRenderer::loadRepeatedStyles()
+{
+    // Design tool exports repeat the same presentation attributes on every element.
+    // Run with QT_LOGGING_RULES="qt.svg.debug=true" to see how many style
+    // properties were shared.
+    QByteArray data = R"(<svg xmlns="http://www.w3.org/2000/svg" width="1000" height="1000">)";
+    for (int i = 0; i < 10000; ++i) {
+        data += QByteArray(R"(<rect x=")") + QByteArray::number(i % 100 * 10)
+                + R"(" y=")" + QByteArray::number(i / 100 * 10)
+                + R"(" width="8" height="8" fill="#336699" fill-opacity="0.8" stroke="#000000")"
+                  R"( stroke-width="0.5" stroke-linejoin="round" font-family="Arial" font-size="12"/>)";
+    }
+    data += "</svg>";
+    QSvgRenderer renderer;
+
+    QBENCHMARK {
+        renderer.load(data);
+    }
+    QVERIFY(renderer.isValid());
+}
+
+void tst_QSvgRenderer::colorParsing_data()
+{
+    QTest::addColumn<QByteArrayList>("colors");
+
+    QTest::newRow("hex") << QByteArrayList{ "#336699", "#fff", "#E5E5E5", "#1a1a1a", "#FF6600" };
+    QTest::newRow("named") << QByteArrayList{ "white", "black", "none", "steelblue", "lightgoldenrodyellow" };
+    QTest::newRow("rgb") << QByteArrayList{ "rgb(51,102,153)", "rgb(255, 255, 255)", "rgb(10%, 20%, 30%)" };
+    QTest::newRow("mixed") << QByteArrayList{ "#336699", "white", "rgb(0,0,0)", "currentColor", "#ccc", "red" };
+}
+
+void tst_QSvgRenderer::colorParsing()
+{
+    QFETCH(QByteArrayList, colors);
+
+    // Every element gets its own fill-opacity, so each fill color is parsed
+    // rather than shared with a previous element
+    QByteArray data = R"(<svg xmlns="http://www.w3.org/2000/svg" width="100" height="100" color="blue">)";
+    for (int i = 0; i < 10000; ++i) {
+        data += R"(<rect width="1" height="1" fill=")" + colors.at(i % colors.size())
+                + R"(" stroke=")" + colors.at((i + 1) % colors.size())
+                + R"(" fill-opacity="0.)" + QByteArray::number(i) + R"(" stroke-opacity="0.)"
+                + QByteArray::number(i) + R"("/>)";
+    }
+    data += "</svg>";
+    QSvgRenderer renderer;
+
+    QBENCHMARK {
+        renderer.load(data);
+    }
+    QVERIFY(renderer.isValid());
+}
+
+void tst_QSvgRenderer::filters_data()
+{
+    QTest::addColumn<QByteArray>("primitive");
+
+    QTest::newRow("feTurbulence")
+            << QByteArray(R"(<feTurbulence baseFrequency="0.02" numOctaves="4" seed="3"/>)");
+    QTest::newRow("feTurbulence-fractalNoise-stitch")
+            << QByteArray(R"(<feTurbulence type="fractalNoise" baseFrequency="0.05" numOctaves="2" stitchTiles="stitch"/>)");
+    QTest::newRow("feConvolveMatrix-3x3")
+            << QByteArray(R"(<feConvolveMatrix order="3" kernelMatrix="1 2 1 2 4 2 1 2 1"/>)");
+    QTest::newRow("feConvolveMatrix-5x5-preserveAlpha")
+            << QByteArray(R"(<feConvolveMatrix order="5" preserveAlpha="true" edgeMode="wrap" )"
+                          R"(kernelMatrix="0 0 -1 0 0 0 -1 -2 -1 0 -1 -2 17 -2 -1 0 -1 -2 -1 0 0 0 -1 0 0"/>)");
+    QTest::newRow("feMorphology-erode")
+            << QByteArray(R"(<feMorphology operator="erode" radius="3"/>)");
+    QTest::newRow("feMorphology-dilate-large")
+            << QByteArray(R"(<feMorphology operator="dilate" radius="25"/>)");
+    QTest::newRow("feDisplacementMap")
+            << QByteArray(R"(<feTurbulence baseFrequency="0.03" result="map"/>)"
+                          R"(<feDisplacementMap in="SourceGraphic" in2="map" scale="30" )"
+                          R"(xChannelSelector="R" yChannelSelector="B"/>)");
+}
+
+void tst_QSvgRenderer::filters()
+{
+    QFETCH(QByteArray, primitive);
+
+    const QByteArray data = QByteArray(R"(<svg xmlns="http://www.w3.org/2000/svg" width="512" height="512">)"
+                                       R"(<filter id="f" x="0" y="0" width="1" height="1">)")
+            + primitive
+            + QByteArray(R"(</filter><g filter="url(#f)">)"
+                         R"(<rect width="512" height="512" fill="white"/>)"
+                         R"(<circle cx="256" cy="256" r="180" fill="red" stroke="blue" stroke-width="30"/>)"
+                         R"(</g></svg>)");
+    QSvgRenderer renderer(data);
+    QVERIFY(renderer.isValid());
+
+    QImage image(512, 512, QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        renderer.render(&painter);
+    }
+}
+
+void tst_QSvgRenderer::patternFill_data()
+{
+    QTest::addColumn<QByteArray>("patternAttributes");
+
+    QTest::newRow("userSpaceOnUse")
+            << QByteArray(R"(patternUnits="userSpaceOnUse" width="16" height="16")");
+    QTest::newRow("translated")
+            << QByteArray(R"(patternUnits="userSpaceOnUse" width="16" height="16" patternTransform="translate(5 3)")");
+    QTest::newRow("scaled")
+            << QByteArray(R"(patternUnits="userSpaceOnUse" width="16" height="16" patternTransform="scale(1.5)")");
+    QTest::newRow("rotated")
+            << QByteArray(R"(patternUnits="userSpaceOnUse" width="16" height="16" patternTransform="rotate(30)")");
+    QTest::newRow("objectBoundingBox")
+            << QByteArray(R"(width="0.025" height="0.025")");
+}
+
+void tst_QSvgRenderer::patternFill()
+{
+    QFETCH(QByteArray, patternAttributes);
+
+    // Hatching of a large area, filled several times with the same pattern
+    const QByteArray data = QByteArray(R"(<svg xmlns="http://www.w3.org/2000/svg" width="1024" height="1024">)"
+                                       R"(<pattern id="p" )")
+            + patternAttributes
+            + QByteArray(R"(><rect width="16" height="16" fill="white"/>)"
+                         R"(<path d="M 0 16 L 16 0" stroke="black" stroke-width="2"/></pattern>)"
+                         R"(<rect width="1024" height="1024" fill="url(#p)"/>)"
+                         R"(<circle cx="512" cy="512" r="400" fill="url(#p)" stroke="url(#p)" stroke-width="20"/>)"
+                         R"(<rect x="100" y="100" width="300" height="800" fill="url(#p)"/>)"
+                         R"(</svg>)");
+    QSvgRenderer renderer(data);
+    QVERIFY(renderer.isValid());
+
+    QImage image(1024, 1024, QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        renderer.render(&painter);
+    }
+}
+
+void tst_QSvgRenderer::imageDownscale_data()
+{
+    QTest::addColumn<QByteArray>("format");
+    QTest::addColumn<QByteArray>("imageRendering");
+
+    QTest::newRow("png-quality") << QByteArray("PNG") << QByteArray("optimizeQuality");
+    QTest::newRow("png-speed") << QByteArray("PNG") << QByteArray("optimizeSpeed");
+    QTest::newRow("jpeg-quality") << QByteArray("JPEG") << QByteArray("optimizeQuality");
+}
+
+void tst_QSvgRenderer::imageDownscale()
+{
+    QFETCH(QByteArray, format);
+    QFETCH(QByteArray, imageRendering);
+
+    // A large embedded photo shown as a grid of small icons
+    QImage photo(2048, 2048, QImage::Format_RGB32);
+    for (int y = 0; y < photo.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(photo.scanLine(y));
+        for (int x = 0; x < photo.width(); ++x)
+            line[x] = qRgb(x & 0xff, y & 0xff, (x ^ y) & 0xff);
+    }
+    QByteArray encoded;
+    QBuffer buffer(&encoded);
+    buffer.open(QIODevice::WriteOnly);
+    if (!photo.save(&buffer, format.constData()))
+        QSKIP("Image format not supported");
+
+    QByteArray data = R"(<svg xmlns="http://www.w3.org/2000/svg" width="512" height="512" image-rendering=")"
+            + imageRendering + R"("><defs><image id="photo" width="64" height="64" href="data:image/)"
+            + format.toLower() + ";base64," + encoded.toBase64() + R"("/></defs>)";
+    for (int y = 0; y < 512; y += 64) {
+        for (int x = 0; x < 512; x += 64)
+            data += QByteArray(R"(<use href="#photo" x=")") + QByteArray::number(x)
+                    + R"(" y=")" + QByteArray::number(y) + R"("/>)";
+    }
+    data += "</svg>";
+    QSvgRenderer renderer(data);
+    QVERIFY(renderer.isValid());
+
+    QImage image(512, 512, QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        renderer.render(&painter);
+    }
+}
+
 QTEST_MAIN(tst_QSvgRenderer)
 #include "tst_qsvgrenderer.moc"